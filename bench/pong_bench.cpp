@@ -0,0 +1,275 @@
+// PONG - Microbenchmarks de los kernels del juego
+// Compila pong.c en esta misma unidad (PONG_NO_MAIN) para llamar directo a sus
+// funciones static. Cada caso: calibración (n ops por repetición >= --min-ms),
+// warmup, --reps repeticiones medidas; reporta ns/op (mínimo y mediana) y ops/s.
+// Uso: pong_bench [--reps N] [--min-ms M] [--warmup-ms M] [--seed S] [--filter TEXTO]
+
+#define PONG_NO_MAIN
+#include "pong.c"
+#include <limits.h>
+
+#define BENCH_MAX_REPS 101
+#define BENCH_FRAMES   4096   // snapshots / estados de bola precalculados (potencia de 2)
+#define BENCH_BATCH_LANES 256
+
+typedef struct {
+    int         reps;
+    int64_t     min_rep_ns;
+    int64_t     warmup_ns;
+    const char* filter;
+} BenchOpts;
+
+typedef struct {
+    const char* name;
+    bool (*setup)(void);   // false: el caso no puede correr en este entorno
+    void (*run)(long n);   // ejecuta n operaciones
+} BenchCase;
+
+// ===== Estado de los casos =====
+// b_sink recibe un resultado de cada op para que el optimizador no las elimine.
+
+static Match         b_match;
+static Ball          b_incoming[BENCH_FRAMES];   // bolas yendo hacia la paleta derecha
+static WorldSnapshot b_snaps[BENCH_FRAMES];      // frames consecutivos de una partida CVC
+static AnsiFb        b_fb;
+static SCREEN*       b_screen = NULL;
+static BatchSim      b_batch;                    // partidas sin fin: cada carril se recarga
+static BatchIsa      b_batch_isa;
+static volatile int  b_sink;
+
+/** @brief Partida headless recién iniciada con la semilla del bench. */
+static bool setup_match(void) {
+    match_init(&b_match, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, 0));
+    return true;
+}
+
+/** @brief Juega CVC desde setup_match() guardando frames y bolas entrantes a la paleta 2. */
+static bool setup_frames(void) {
+    setup_match();
+    Match m = b_match;
+    uint64_t n_played = 1;
+    int n_snaps = 0, n_incoming = 0;
+    while (n_snaps < BENCH_FRAMES || n_incoming < BENCH_FRAMES) {
+        if (match_finished(&m)) match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, n_played++));
+        int dir1 = match_cpu_dir(&m, 1);
+        int dir2 = match_cpu_dir(&m, 2);
+        match_step(&m, dir1, dir2);
+        if (n_snaps < BENCH_FRAMES) snapshot_from_match(&b_snaps[n_snaps++], &m);
+        if (n_incoming < BENCH_FRAMES && m.ball.vx > 0) b_incoming[n_incoming++] = m.ball;
+    }
+    return true;
+}
+
+/** @brief Terminal curses nulo (entrada y salida a /dev/null) con las ventanas del campo. */
+static bool setup_curses(void) {
+    setup_frames();
+    if (!b_screen) {
+        FILE* out = fopen("/dev/null", "w");
+        FILE* in  = fopen("/dev/null", "r");
+        if (!out || !in) return false;
+        setenv("LINES",   "24", 1);
+        setenv("COLUMNS", "80", 1);
+        b_screen = newterm("xterm", out, in);
+        if (!b_screen) return false;
+    }
+    g_match = b_match;
+    create_field_windows(HEADLESS_LINES, HEADLESS_COLS);
+    return g_win_static && g_win_dynamic;
+}
+
+/** @brief Framebuffer ANSI que escribe a /dev/null. */
+static bool setup_ansi(void) {
+    setup_frames();
+    if (b_fb.out) return true;
+    int fd = open("/dev/null", O_WRONLY);
+    return fd >= 0 && ansi_fb_init(&b_fb, fd, HEADLESS_LINES, HEADLESS_COLS);
+}
+
+/** @brief Lote SoA de BENCH_BATCH_LANES partidas con el mejor kernel de la CPU. */
+static bool setup_batch(void) {
+    b_batch_isa = batch_best_isa();
+    return b_batch.mem || batch_init(&b_batch, BENCH_BATCH_LANES, 0, LONG_MAX, g_cpu_config, g_cpu_config);
+}
+
+// ===== Kernels =====
+
+/** @brief Paleta con entrada arriba / neutro / abajo en tramos de 16 ticks. */
+static void run_move_paddle(long n) {
+    for (long i = 0; i < n; ++i) {
+        move_paddle(&b_match, &b_match.pad1, (int)((i >> 4) % 3) - 1);
+    }
+    b_sink = (int)b_match.pad1.y;
+}
+
+/** @brief Paso de bola de un tick; las paletas siguen a la bola (rally con rebotes). */
+static void run_ball_step(long n) {
+    for (long i = 0; i < n; ++i) {
+        b_match.pad1.y = b_match.ball.y;
+        b_match.pad2.y = b_match.ball.y;
+        match_ball_step(&b_match);
+    }
+    b_sink = (int)b_match.ball.x;
+}
+
+/** @brief Decisión de la IA con una trayectoria nueva en cada llamada (predicción completa). */
+static void run_cpu_replan(long n) {
+    int acc = 0;
+    for (long i = 0; i < n; ++i) {
+        b_match.ball = b_incoming[i & (BENCH_FRAMES - 1)];
+        b_match.traj_gen++;
+        acc += cpu_calculate_direction(&b_match, 2);
+    }
+    b_sink = acc;
+}
+
+/** @brief Decisión de la IA reutilizando el plan (caso común entre golpes). */
+static void run_cpu_cached(long n) {
+    int acc = 0;
+    b_match.ball = b_incoming[0];
+    for (long i = 0; i < n; ++i) acc += cpu_calculate_direction(&b_match, 2);
+    b_sink = acc;
+}
+
+/** @brief Saque aleatorio alternando el lado. */
+static void run_ball_spawn(long n) {
+    for (long i = 0; i < n; ++i) ball_spawn_random(&b_match, i & 1);
+    b_sink = (int)b_match.ball.y;
+}
+
+/** @brief Tick CVC completo (dos decisiones de IA + match_step). */
+static void run_match_step(long n) {
+    for (long i = 0; i < n; ++i) {
+        if (match_finished(&b_match)) b_match.score.p1 = b_match.score.p2 = 0;
+        int dir1 = match_cpu_dir(&b_match, 1);
+        int dir2 = match_cpu_dir(&b_match, 2);
+        match_step(&b_match, dir1, dir2);
+    }
+    b_sink = (int)b_match.ticks;
+}
+
+/** @brief Ticks del lote SoA; una op = un tick de una partida (comparable con match_step CVC). */
+static void run_batch_tick(long n) {
+    for (long t = (n + BENCH_BATCH_LANES - 1) / BENCH_BATCH_LANES; t > 0; --t) batch_tick_isa(&b_batch, b_batch_isa);
+    b_sink = b_batch.ticks[0];
+}
+
+/** @brief render_dirty() sobre frames consecutivos, sin volcar al terminal. */
+static void run_render_dirty(long n) {
+    for (long i = 0; i < n; ++i) render_dirty(g_win_dynamic, &b_snaps[i & (BENCH_FRAMES - 1)]);
+}
+
+/** @brief Frame curses completo: render_dirty() + wnoutrefresh() + doupdate() a /dev/null. */
+static void run_render_doupdate(long n) {
+    for (long i = 0; i < n; ++i) {
+        render_dirty(g_win_dynamic, &b_snaps[i & (BENCH_FRAMES - 1)]);
+        wnoutrefresh(g_win_dynamic);
+        doupdate();
+    }
+}
+
+/** @brief Frame ANSI completo: ansi_draw_world() + ansi_fb_present() a /dev/null. */
+static void run_render_ansi(long n) {
+    for (long i = 0; i < n; ++i) {
+        ansi_draw_world(&b_fb, &b_match, &b_snaps[i & (BENCH_FRAMES - 1)]);
+        ansi_fb_present(&b_fb);
+    }
+}
+
+static const BenchCase BENCH_CASES[] = {
+    { "move_paddle",                    setup_match,  run_move_paddle },
+    { "match_ball_step",                setup_match,  run_ball_step },
+    { "cpu_calculate_direction (plan)", setup_frames, run_cpu_replan },
+    { "cpu_calculate_direction (cache)", setup_frames, run_cpu_cached },
+    { "ball_spawn_random",              setup_match,  run_ball_spawn },
+    { "match_step CVC",                 setup_match,  run_match_step },
+    { "batch_tick SoA (por partida)",   setup_batch,  run_batch_tick },
+    { "render_dirty",                   setup_curses, run_render_dirty },
+    { "render_dirty + doupdate",        setup_curses, run_render_doupdate },
+    { "ansi draw + present",            setup_ansi,   run_render_ansi },
+};
+
+// ===== Arnés =====
+
+/** @brief Duración en ns de n operaciones. */
+static int64_t bench_time_ns(void (*run)(long), long n) {
+    const int64_t t0 = mono_ns();
+    run(n);
+    return mono_ns() - t0;
+}
+
+/** @brief Calibra, calienta y mide un caso; imprime una fila de la tabla. */
+static void bench_case(const BenchCase* c, const BenchOpts* o) {
+    if (!c->setup()) {
+        printf("%-32s %s\n", c->name, "(omitido: no se pudo preparar)");
+        return;
+    }
+    // Calibración: duplica n hasta que una repetición dure al menos min_rep_ns.
+    long n = 1;
+    while (bench_time_ns(c->run, n) < o->min_rep_ns && n < (1L << 30)) n *= 2;
+
+    const int64_t w0 = mono_ns();
+    while (mono_ns() - w0 < o->warmup_ns) c->run(n);
+
+    double ns_op[BENCH_MAX_REPS];
+    for (int r = 0; r < o->reps; ++r) ns_op[r] = (double)bench_time_ns(c->run, n) / n;
+    std::sort(ns_op, ns_op + o->reps);
+    const double med = ns_op[o->reps / 2];
+    printf("%-32s %11ld %10.2f %10.2f %14.0f\n", c->name, n, ns_op[0], med, med > 0 ? 1e9 / med : 0.0);
+    fflush(stdout);
+}
+
+/** @brief Muestra las opciones de línea de comandos. */
+static void bench_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s [--reps N] [--min-ms M] [--warmup-ms M] [--seed S] [--filter TEXTO]\n", prog);
+    fprintf(stderr, "  --reps N       repeticiones medidas por caso (default 15, max %d)\n", BENCH_MAX_REPS);
+    fprintf(stderr, "  --min-ms M     duración mínima de cada repetición (default 20)\n");
+    fprintf(stderr, "  --warmup-ms M  calentamiento por caso antes de medir (default 100)\n");
+    fprintf(stderr, "  --seed S       semilla de las partidas (default 42)\n");
+    fprintf(stderr, "  --filter TEXTO solo los casos cuyo nombre contiene TEXTO\n");
+}
+
+int main(int argc, char** argv) {
+    BenchOpts o = { 15, 20 * 1000000LL, 100 * 1000000LL, NULL };
+    g_seed = 42;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            o.reps = std::clamp((int)strtol(argv[++i], NULL, 10), 1, BENCH_MAX_REPS);
+        } else if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+            o.min_rep_ns = std::max(1L, strtol(argv[++i], NULL, 10)) * 1000000LL;
+        } else if (strcmp(argv[i], "--warmup-ms") == 0 && i + 1 < argc) {
+            o.warmup_ns = std::max(0L, strtol(argv[++i], NULL, 10)) * 1000000LL;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            g_seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            o.filter = argv[++i];
+        } else {
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    strncpy(g_name1, "CPU 1", NAME_MAXLEN);
+    strncpy(g_name2, "CPU 2", NAME_MAXLEN);
+
+    printf("--- MICROBENCHMARKS (%s, campo %dx%d, semilla %llu) ---\n",
+#ifdef PONG_FIXED_POINT
+           "punto fijo",
+#else
+           "float",
+#endif
+           HEADLESS_COLS, HEADLESS_LINES, (unsigned long long)g_seed);
+    printf("%-32s %11s %10s %10s %14s\n", "", "ops/rep", "min ns/op", "p50 ns/op", "ops/s");
+    for (const BenchCase& c : BENCH_CASES) {
+        if (o.filter && !strstr(c.name, o.filter)) continue;
+        bench_case(&c, &o);
+    }
+
+    if (b_screen) {
+        if (g_win_static)  delwin(g_win_static);
+        if (g_win_dynamic) delwin(g_win_dynamic);
+        endwin();
+        delscreen(b_screen);
+    }
+    ansi_fb_free(&b_fb);
+    batch_free(&b_batch);
+    return 0;
+}
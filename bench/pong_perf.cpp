@@ -0,0 +1,342 @@
+// PONG - Suite de regresión de rendimiento
+// Escenarios deterministas (semilla fija, CVC headless) que miden ticks/s, bytes por
+// frame y asignaciones de memoria, y los comparan con bench/perf_baseline.txt.
+// Salida: una línea JSON por métrica en stdout (resumen legible en stderr); código de
+// salida != 0 si alguna métrica pasa su límite. Corre como test de ctest (label perf).
+// Los ticks/s y frames/s dependen de la máquina: por defecto solo se informan y el test
+// compara lo reproducible (asignaciones, bytes por frame, puntos). --check-throughput
+// también los compara; tiene sentido en la máquina donde se generó el baseline.
+// Uso: pong_perf --baseline F [--update-baseline] [--check-throughput] [--seed S]
+
+#define PONG_NO_MAIN
+#include "pong.c"
+
+#define PERF_REPS          3         // se queda con la mejor repetición de cada escenario
+#define PERF_RALLY_TICKS   2000000L
+#define PERF_MATCHES       200L
+#define PERF_ANSI_FRAMES   20000L
+#define PERF_CURSES_FRAMES 5000L
+#define PERF_MAX_RESULTS   32
+
+// ===== Conteo de asignaciones =====
+// malloc/calloc/realloc se reemplazan por envoltorios sobre los de glibc; perf_allocs
+// cuenta todas las llamadas del proceso (los escenarios leen la diferencia).
+
+extern "C" void* __libc_malloc(size_t n);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t n);
+
+static std::atomic<long> perf_allocs{0};
+
+extern "C" void* malloc(size_t n) {
+    perf_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(n);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    perf_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t n) {
+    perf_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, n);
+}
+
+// ===== Resultados y baseline =====
+
+typedef struct {
+    const char* scenario;
+    const char* metric;
+    double      value;
+} PerfResult;
+
+typedef struct {
+    char   scenario[32];
+    char   metric[32];
+    double baseline;
+    double tol;       // fracción permitida de empeoramiento respecto de baseline
+} BaselineRow;
+
+static PerfResult  g_results[PERF_MAX_RESULTS];
+static int         g_n_results = 0;
+static BaselineRow g_base[PERF_MAX_RESULTS];
+static int         g_n_base = 0;
+
+/** @brief Guarda una medición. */
+static void perf_result(const char* scenario, const char* metric, double value) {
+    if (g_n_results < PERF_MAX_RESULTS) g_results[g_n_results++] = { scenario, metric, value };
+}
+
+/** @brief true si más es mejor (métricas *_per_s); el resto (bytes, asignaciones) al revés. */
+static bool metric_higher_is_better(const char* metric) {
+    size_t n = strlen(metric);
+    return n > 6 && strcmp(metric + n - 6, "_per_s") == 0;
+}
+
+/** @brief Lee "escenario métrica baseline tolerancia" por línea ('#' = comentario). */
+static bool baseline_load(const char* path) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), fp) && g_n_base < PERF_MAX_RESULTS) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        BaselineRow* r = &g_base[g_n_base];
+        if (sscanf(line, "%31s %31s %lf %lf", r->scenario, r->metric, &r->baseline, &r->tol) == 4) g_n_base++;
+    }
+    fclose(fp);
+    return true;
+}
+
+/** @brief Fila de baseline de una métrica, o NULL. */
+static const BaselineRow* baseline_find(const char* scenario, const char* metric) {
+    for (int i = 0; i < g_n_base; ++i) {
+        if (strcmp(g_base[i].scenario, scenario) == 0 && strcmp(g_base[i].metric, metric) == 0) return &g_base[i];
+    }
+    return NULL;
+}
+
+/** @brief Reescribe el baseline con las mediciones actuales (conserva tolerancias). */
+static bool baseline_write(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) return false;
+    fprintf(fp, "# Baseline de pong_perf: escenario metrica valor tolerancia\n");
+    fprintf(fp, "# *_per_s fallan si valor < baseline * (1 - tol) (solo con --check-throughput);\n");
+    fprintf(fp, "# el resto si valor > baseline * (1 + tol).\n");
+    fprintf(fp, "# Regenerar con: pong_perf --baseline bench/perf_baseline.txt --update-baseline\n");
+    for (int i = 0; i < g_n_results; ++i) {
+        const PerfResult* r = &g_results[i];
+        const BaselineRow* b = baseline_find(r->scenario, r->metric);
+        double tol = b ? b->tol : metric_higher_is_better(r->metric) ? 0.5 : 0.1;
+        fprintf(fp, "%-14s %-16s %14.2f %5.2f\n", r->scenario, r->metric, r->value, tol);
+    }
+    return fclose(fp) == 0;
+}
+
+// ===== Escenarios =====
+// Cada uno se repite PERF_REPS veces y reporta la mejor; las asignaciones se cuentan
+// solo dentro del bucle medido (la preparación, p. ej. newterm(), queda afuera).
+
+/** @brief Rally sin fin a BALL_SPEED_MAX: en cada trayectoria nueva las paletas se
+ *         colocan en la fila de llegada exacta (golpe centrado, vy no deriva).
+ */
+static void scenario_rally_max(void) {
+    double best = 0.0;
+    long points = 0, allocs = 0;
+    for (int rep = 0; rep < PERF_REPS; ++rep) {
+        Match m;
+        match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, 0));
+        ball_scale_speed(&m.ball, num_t(BALL_SPEED_MAX));
+        unsigned placed_gen = m.traj_gen - 1;
+        const long a0 = perf_allocs.load();
+        const int64_t t0 = mono_ns();
+        for (long t = 0; t < PERF_RALLY_TICKS; ++t) {
+            if (placed_gen != m.traj_gen) {
+                m.pad1.y = cpu_predict_arrival_y(&m, num_t(m.pad1.x + 1));
+                m.pad2.y = cpu_predict_arrival_y(&m, num_t(m.pad2.x - 1));
+                placed_gen = m.traj_gen;
+            }
+            match_step(&m, 0, 0);
+        }
+        const int64_t dt = mono_ns() - t0;
+        allocs = std::max(allocs, perf_allocs.load() - a0);
+        points = std::max(points, (long)(m.score.p1 + m.score.p2));
+        best = std::max(best, PERF_RALLY_TICKS * 1e9 / (double)dt);
+    }
+    perf_result("rally_max", "ticks_per_s", best);
+    perf_result("rally_max", "points", (double)points);   // != 0: el rally se cortó
+    perf_result("rally_max", "allocs", (double)allocs);
+}
+
+/** @brief PERF_MATCHES partidas CVC completas hasta SCORE_TO_WIN (IA incluida). */
+static void scenario_match_full(void) {
+    double best = 0.0;
+    long allocs = 0;
+    for (int rep = 0; rep < PERF_REPS; ++rep) {
+        long long ticks = 0;
+        const long a0 = perf_allocs.load();
+        const int64_t t0 = mono_ns();
+        for (long i = 0; i < PERF_MATCHES; ++i) {
+            Match m;
+            match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, (uint64_t)i));
+            while (!match_finished(&m) && m.ticks < HEADLESS_MAX_TICKS) {
+                int dir1 = match_cpu_dir(&m, 1);
+                int dir2 = match_cpu_dir(&m, 2);
+                match_step(&m, dir1, dir2);
+            }
+            ticks += m.ticks;
+        }
+        const int64_t dt = mono_ns() - t0;
+        allocs = std::max(allocs, perf_allocs.load() - a0);
+        best = std::max(best, ticks * 1e9 / (double)dt);
+    }
+    perf_result("match_full", "ticks_per_s", best);
+    perf_result("match_full", "allocs", (double)allocs);
+}
+
+/** @brief Tick CVC + frame del backend ANSI a /dev/null. */
+static bool scenario_render_ansi(void) {
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) return false;
+    double best = 0.0, bytes = 0.0;
+    long allocs = 0;
+    for (int rep = 0; rep < PERF_REPS; ++rep) {
+        Match m;
+        match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, 0));
+        AnsiFb fb;
+        if (!ansi_fb_init(&fb, fd, HEADLESS_LINES, HEADLESS_COLS)) { ansi_fb_free(&fb); close(fd); return false; }
+        WorldSnapshot snap;
+        const long a0 = perf_allocs.load();
+        const int64_t t0 = mono_ns();
+        for (long f = 0; f < PERF_ANSI_FRAMES; ++f) {
+            if (match_finished(&m)) m.score.p1 = m.score.p2 = 0;
+            int dir1 = match_cpu_dir(&m, 1);
+            int dir2 = match_cpu_dir(&m, 2);
+            match_step(&m, dir1, dir2);
+            snapshot_from_match(&snap, &m);
+            ansi_draw_world(&fb, &m, &snap);
+            ansi_fb_present(&fb);
+        }
+        const int64_t dt = mono_ns() - t0;
+        allocs = std::max(allocs, perf_allocs.load() - a0);
+        best = std::max(best, PERF_ANSI_FRAMES * 1e9 / (double)dt);
+        bytes = (double)fb.bytes / fb.frames;
+        ansi_fb_free(&fb);
+    }
+    close(fd);
+    perf_result("render_ansi", "frames_per_s", best);
+    perf_result("render_ansi", "bytes_per_frame", bytes);
+    perf_result("render_ansi", "allocs", (double)allocs);
+    return true;
+}
+
+/** @brief Tick CVC + render_dirty() + doupdate() de ncurses sobre un archivo temporal. */
+static bool scenario_render_curses(void) {
+    FILE* out = tmpfile();
+    FILE* in  = fopen("/dev/null", "r");
+    if (!out || !in) return false;
+    setenv("LINES",   "24", 1);
+    setenv("COLUMNS", "80", 1);
+    SCREEN* scr = newterm("xterm", out, in);
+    if (!scr) return false;
+
+    double best = 0.0, bytes = 0.0;
+    long allocs = 0;
+    for (int rep = 0; rep < PERF_REPS; ++rep) {
+        match_init(&g_match, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, 0));
+        create_field_windows(HEADLESS_LINES, HEADLESS_COLS);
+        fflush(out);
+        const off_t pos0 = lseek(fileno(out), 0, SEEK_END);
+        WorldSnapshot snap;
+        const long a0 = perf_allocs.load();
+        const int64_t t0 = mono_ns();
+        for (long f = 0; f < PERF_CURSES_FRAMES; ++f) {
+            if (match_finished(&g_match)) g_match.score.p1 = g_match.score.p2 = 0;
+            int dir1 = match_cpu_dir(&g_match, 1);
+            int dir2 = match_cpu_dir(&g_match, 2);
+            match_step(&g_match, dir1, dir2);
+            snapshot_from_match(&snap, &g_match);
+            render_dirty(g_win_dynamic, &snap);
+            wnoutrefresh(g_win_dynamic);
+            doupdate();
+        }
+        const int64_t dt = mono_ns() - t0;
+        allocs = std::max(allocs, perf_allocs.load() - a0);
+        fflush(out);
+        bytes = (double)(lseek(fileno(out), 0, SEEK_END) - pos0) / PERF_CURSES_FRAMES;
+        best = std::max(best, PERF_CURSES_FRAMES * 1e9 / (double)dt);
+    }
+    delwin(g_win_static);  g_win_static  = NULL;
+    delwin(g_win_dynamic); g_win_dynamic = NULL;
+    endwin();
+    delscreen(scr);
+    fclose(out);
+    fclose(in);
+    perf_result("render_curses", "frames_per_s", best);
+    perf_result("render_curses", "bytes_per_frame", bytes);
+    perf_result("render_curses", "allocs", (double)allocs);
+    return true;
+}
+
+// ===== Comparación =====
+
+/** @brief Compara cada resultado con su baseline; imprime JSON y resumen. @return fallas. */
+static int perf_check(bool gate_throughput) {
+    int failed = 0;
+    for (int i = 0; i < g_n_results; ++i) {
+        const PerfResult* r = &g_results[i];
+        const BaselineRow* b = baseline_find(r->scenario, r->metric);
+        const bool higher = metric_higher_is_better(r->metric);
+        double limit = 0.0;
+        bool ok = true;
+        if (b) {
+            limit = higher ? b->baseline * (1.0 - b->tol) : b->baseline * (1.0 + b->tol);
+            ok = higher ? (r->value >= limit || !gate_throughput) : r->value <= limit;
+        }
+        const bool gated = !higher || gate_throughput;
+        if (!ok) failed++;
+        printf("{\"scenario\":\"%s\",\"metric\":\"%s\",\"value\":%.2f,", r->scenario, r->metric, r->value);
+        if (b) printf("\"baseline\":%.2f,\"limit\":%.2f,", b->baseline, limit);
+        else   printf("\"baseline\":null,\"limit\":null,");
+        printf("\"gated\":%s,\"ok\":%s}\n", gated ? "true" : "false", ok ? "true" : "false");
+        fprintf(stderr, "%-5s %-14s %-16s %14.2f", ok ? "OK" : "FALLA", r->scenario, r->metric, r->value);
+        if (b) fprintf(stderr, "   (limite %s %.2f%s)\n", higher ? ">=" : "<=", limit, gated ? "" : ", informativo");
+        else   fprintf(stderr, "   (sin baseline)\n");
+    }
+    printf("{\"suite\":\"pong_perf\",\"results\":%d,\"failed\":%d}\n", g_n_results, failed);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    const char* baseline_path = NULL;
+    bool update = false;
+    bool check_throughput = false;
+    g_seed = 42;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--update-baseline") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "--check-throughput") == 0) {
+            check_throughput = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            g_seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s --baseline F [--update-baseline] [--check-throughput] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!baseline_path) {
+        fprintf(stderr, "Falta --baseline F\n");
+        return 2;
+    }
+    if (!baseline_load(baseline_path) && !update) {
+        fprintf(stderr, "No se pudo leer %s\n", baseline_path);
+        return 2;
+    }
+    strncpy(g_name1, "CPU 1", NAME_MAXLEN);
+    strncpy(g_name2, "CPU 2", NAME_MAXLEN);
+
+    scenario_rally_max();
+    scenario_match_full();
+    if (!scenario_render_ansi())   fprintf(stderr, "render_ansi omitido: no se pudo abrir /dev/null\n");
+    if (!scenario_render_curses()) fprintf(stderr, "render_curses omitido: sin terminal nulo\n");
+
+    if (update) {
+        if (!baseline_write(baseline_path)) {
+            fprintf(stderr, "No se pudo escribir %s\n", baseline_path);
+            return 2;
+        }
+        fprintf(stderr, "Baseline actualizado: %s\n", baseline_path);
+        return 0;
+    }
+
+    // Sin optimizar (build Debug) los ticks/s no son comparables ni pidiéndolo.
+#ifdef NDEBUG
+    const bool gate_throughput = check_throughput;
+#else
+    const bool gate_throughput = false;
+    if (check_throughput) fprintf(stderr, "Build sin NDEBUG: las métricas *_per_s no se comparan\n");
+#endif
+    return perf_check(gate_throughput) ? 1 : 0;
+}
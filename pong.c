@@ -1,7 +1,11 @@
 // PONG - CON MODO CPU VS JUGADOR
 // CC3086 - Programación de microprocesadores
 // Requiere: ncurses y pthreads
-// Compilar: g++ -std=c++17 pong.c -o pong -lncursesw -lpthread -lm
+// Compilar: cmake -S . -B build && cmake --build build   (targets: pong, pong_bench, bench, pong_perf)
+//           o a mano: g++ -std=c++17 pong.c -o pong -lncursesw -lpthread -lm
+//           (agregar -DPONG_FIXED_POINT para física en punto fijo, determinista bit a bit)
+//           Regresión de rendimiento: ctest --test-dir build -L perf
+//           Con -DPONG_NO_MAIN se omite main() para incluir este archivo (bench/pong_bench.cpp).
 
 
 // ===== Includes estándar y de terceros =====
@@ -14,19 +18,226 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <poll.h>
+#include <errno.h>
 //Para el calculo de tiempos
 #include <chrono>
+#include <atomic>
+#include <algorithm>
 using namespace std::chrono;
-// ===== Medición de tiempos (acumuladores globales) =====
-// time_* acumulan segundos invertidos por subsistema para el perfil final.
+// ===== Medición de tiempos =====
+// Por tick/frame: histogramas log-lineales (estilo HDR) por subsistema. Cada histograma
+// tiene un único hilo escritor (sin locks); th_sim graba en uno propio y lo fusiona en
+// el global al terminar, antes del pthread_join. Por escena: time_* acumulan segundos.
+
+#define HIST_SUB_BITS 4                                   // 16 sub-cubos por potencia de 2 (error < 6.25%)
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t n;
+    int64_t  min, max;   // exactos, en ns
+    double   sum_ns;
+} Histogram;
+
+/** @brief Cubo de un valor en ns: exacto bajo HIST_SUB, luego HIST_SUB cubos por octava. */
+static inline int hist_bucket(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int k = 63 - __builtin_clzll(v);                      // bit más alto (>= HIST_SUB_BITS)
+    int sub = (int)(v >> (k - HIST_SUB_BITS)) - HIST_SUB; // siguientes HIST_SUB_BITS bits
+    return ((k - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + sub;
+}
+
+/** @brief Valor representativo (punto medio) de un cubo, en ns. */
+static double hist_bucket_mid(int i) {
+    if (i < HIST_SUB) return (double)i;
+    int g = i >> HIST_SUB_BITS, sub = i & (HIST_SUB - 1);
+    int shift = g - 1;
+    double lo = (double)((uint64_t)(HIST_SUB + sub) << shift);
+    return lo + (double)(1ull << shift) / 2.0;
+}
+
+/** @brief Registra una duración (ns). Solo el hilo dueño del histograma. */
+static inline void hist_record(Histogram* h, int64_t ns) {
+    if (ns < 0) ns = 0;
+    h->counts[hist_bucket((uint64_t)ns)]++;
+    if (h->n == 0 || ns < h->min) h->min = ns;
+    if (h->n == 0 || ns > h->max) h->max = ns;
+    h->n++;
+    h->sum_ns += (double)ns;
+}
+
+/** @brief Suma src en dst (los dos quietos: sin escritores concurrentes). */
+static void hist_merge(Histogram* dst, const Histogram* src) {
+    if (src->n == 0) return;
+    for (int i = 0; i < HIST_BUCKETS; ++i) dst->counts[i] += src->counts[i];
+    if (dst->n == 0 || src->min < dst->min) dst->min = src->min;
+    if (dst->n == 0 || src->max > dst->max) dst->max = src->max;
+    dst->n += src->n;
+    dst->sum_ns += src->sum_ns;
+}
+
+/** @brief Percentil q (0..1) en ns; min/max exactos en los extremos. */
+static double hist_percentile(const Histogram* h, double q) {
+    if (h->n == 0) return 0.0;
+    uint64_t rank = (uint64_t)(q * (double)(h->n - 1)) + 1, seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            double v = hist_bucket_mid(i);
+            if (v < h->min) v = (double)h->min;
+            if (v > h->max) v = (double)h->max;
+            return v;
+        }
+    }
+    return (double)h->max;
+}
+
+/** @brief Segundos totales registrados. */
+static double hist_seconds(const Histogram* h) { return h->sum_ns / 1e9; }
+
+/** @brief Imprime una fila n/min/p50/p99/max en microsegundos. */
+static void hist_print_row(const char* name, const Histogram* h) {
+    if (h->n == 0) { printf("%-17s %9s\n", name, "-"); return; }
+    printf("%-17s %9llu %10.2f %10.2f %10.2f %10.2f\n", name, (unsigned long long)h->n,
+           h->min / 1e3, hist_percentile(h, 0.50) / 1e3, hist_percentile(h, 0.99) / 1e3,
+           h->max / 1e3);
+}
+
+/** @brief Reloj CLOCK_MONOTONIC en ns. */
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** @brief CPU consumida por el hilo que llama (CLOCK_THREAD_CPUTIME_ID), en ns. */
+static int64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// CPU real y uso de g_lock por hilo (cada ThreadStats tiene un único escritor; las
+// sesiones de th_sim son secuenciales). Separa trabajo de tiempo bloqueado.
+typedef struct {
+    int64_t   cpu_ns;        // CPU acumulada (CLOCK_THREAD_CPUTIME_ID)
+    int64_t   lock_wait_ns;  // esperando adquirir g_lock
+    int64_t   lock_hold_ns;  // con g_lock tomado
+    long long lock_count;
+    int64_t   lock_t0;       // adquisición en curso
+} ThreadStats;
+
+static ThreadStats g_ts_main, g_ts_sim, g_ts_input, g_ts_lb;
+
+/** @brief pthread_mutex_lock midiendo la espera (sobre ts del hilo llamador). */
+static void lock_timed(pthread_mutex_t* m, ThreadStats* ts) {
+    const int64_t t0 = mono_ns();
+    pthread_mutex_lock(m);
+    ts->lock_t0 = mono_ns();
+    ts->lock_wait_ns += ts->lock_t0 - t0;
+    ts->lock_count++;
+}
+
+/** @brief pthread_mutex_unlock sumando el tiempo retenido desde lock_timed(). */
+static void unlock_timed(pthread_mutex_t* m, ThreadStats* ts) {
+    ts->lock_hold_ns += mono_ns() - ts->lock_t0;
+    pthread_mutex_unlock(m);
+}
+
+// ===== Trazas de ejecución (--trace F, formato Chrome Trace Event) =====
+// Un anillo por hilo (un solo escritor cada uno, sin locks); si se llena se pisan
+// los eventos más viejos. Cada evento es un intervalo completo (ph "X"). Al salir,
+// con todos los hilos ya unidos, trace_write() vuelca los anillos a JSON para
+// chrome://tracing o Perfetto.
+
+#define TRACE_RING_CAP (1u << 18)   // eventos por hilo (potencia de 2)
+
+typedef struct {
+    const char* name;    // literal estático
+    int64_t     t0_ns;   // CLOCK_MONOTONIC
+    int64_t     dur_ns;
+} TraceEvent;
+
+typedef struct {
+    const char* thread_name;
+    int         tid;
+    TraceEvent* ev;      // NULL = trazas desactivadas
+    uint64_t    n;       // eventos escritos (incluye los pisados)
+} TraceRing;
+
+static const char* g_trace_path = NULL;
+static int64_t     g_trace_t0 = 0;
+static TraceRing   g_tr_main  = { "principal",   1, NULL, 0 };
+static TraceRing   g_tr_sim   = { "simulacion",  2, NULL, 0 };
+static TraceRing   g_tr_input = { "entrada",     3, NULL, 0 };
+static TraceRing   g_tr_lb    = { "leaderboard", 4, NULL, 0 };
+
+/** @brief Registra el intervalo [t0, t1] en el anillo del hilo que llama. */
+static inline void trace_span(TraceRing* r, const char* name, int64_t t0, int64_t t1) {
+    if (!r->ev) return;
+    TraceEvent* e = &r->ev[r->n++ & (TRACE_RING_CAP - 1)];
+    e->name   = name;
+    e->t0_ns  = t0;
+    e->dur_ns = t1 - t0;
+}
+
+/** @brief Reserva los anillos (antes de crear hilos). false si no hay memoria. */
+static bool trace_start(void) {
+    TraceRing* rings[] = { &g_tr_main, &g_tr_sim, &g_tr_input, &g_tr_lb };
+    for (TraceRing* r : rings) {
+        r->ev = (TraceEvent*)malloc(TRACE_RING_CAP * sizeof(TraceEvent));
+        if (!r->ev) return false;
+    }
+    g_trace_t0 = mono_ns();
+    return true;
+}
+
+/** @brief Escribe los anillos en JSON y los libera. Solo con los demás hilos ya unidos. */
+static bool trace_write(const char* path) {
+    TraceRing* rings[] = { &g_tr_main, &g_tr_sim, &g_tr_input, &g_tr_lb };
+    FILE* fp = fopen(path, "w");
+    bool ok = fp != NULL;
+    if (ok) {
+        fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (TraceRing* r : rings) {
+            fprintf(fp, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", r->tid, r->thread_name);
+            first = false;
+            if (!r->ev) continue;
+            uint64_t begin = r->n > TRACE_RING_CAP ? r->n - TRACE_RING_CAP : 0;
+            for (uint64_t i = begin; i < r->n; ++i) {
+                const TraceEvent* e = &r->ev[i & (TRACE_RING_CAP - 1)];
+                fprintf(fp, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}",
+                        r->tid, e->name, (e->t0_ns - g_trace_t0) / 1e3, e->dur_ns / 1e3);
+            }
+        }
+        fprintf(fp, "\n]}\n");
+        ok = fclose(fp) == 0;
+    }
+    for (TraceRing* r : rings) { free(r->ev); r->ev = NULL; }
+    return ok;
+}
+
+// Tiempos de simulación por tick (th_sim los fusiona al terminar) y de render por frame.
+typedef struct {
+    Histogram p1, p2, ball;
+} SimProfile;
+
+static SimProfile g_prof_sim;
+static Histogram  g_hist_render;   // solo el hilo principal
 
-static duration<double> time_ball{0};
-static duration<double> time_p1{0};
-static duration<double> time_p2{0};
 static duration<double> time_menu{0};
 static duration<double> time_instructions{0};
 static duration<double> time_leaderboard{0};
-static duration<double> time_render{0};
 
 
 
@@ -35,6 +246,8 @@ static duration<double> time_render{0};
 
 #define TARGET_FPS_PLAY 60
 #define FRAME_USEC_PLAY (1000000 / TARGET_FPS_PLAY)
+#define TICK_NSEC_PLAY  (1000000000L / TARGET_FPS_PLAY)
+#define SIM_MAX_CATCHUP 5   // ticks máximos por despertar antes de descartar atraso
 
 #define PADDLE_LEN 5
 #define PADDLE_SPEED 1
@@ -49,10 +262,22 @@ static duration<double> time_render{0};
 
 #define NAME_MAXLEN 24
 #define LEADERBOARD_FILE "pong_scores.txt"
-#define MAX_LEADER_ENTRIES 200
+#define LEADERBOARD_TOP 10
+
+// Leaderboard binario multi-proceso: journal con CRC + snapshot ordenado.
+#define LEADERBOARD_JNL   "pong_scores.jnl"
+#define LEADERBOARD_SNAP  "pong_scores.snap"
+#define LB_COMPACT_EVERY  256    // registros en el journal antes de compactar
+#define LB_QUEUE_CAP      64     // cola del escritor asíncrono (y lote máximo)
+#define LEADERBOARD_PLAYERS "pong_players.dat"
+
+// Repeticiones: semilla + entradas por tick (RLE) + keyframes periódicos para buscar.
+#define REPLAY_KEYFRAME_EVERY 600   // ticks entre keyframes (10 s a 60 FPS)
+#define REPLAY_SEEK_TICKS     600   // salto de las flechas izq/der en el visor
 
 #define BALL_SPEED_MIN 0.45f
 #define BALL_SPEED_MAX 1.10f
+#define BALL_MAX_CONTACTS 8   // contactos resueltos por tick (rebotes + paletas)
 
 // ===== Ventanas de ncurses (capa estática y dinámica) =====
 // g_win_static: bordes/cancha (se dibuja una vez).
@@ -65,21 +290,110 @@ static WINDOW* g_win_dynamic = NULL;
 // ===== Dificultad/IA: reacción y margen de error =====
 #define CPU_REACTION_DELAY 3  // Frames de delay para la CPU
 #define CPU_ERROR_MARGIN 1.5f // Margen de error en la predicción
+#define CPU_ERROR_PCT 30      // % de trayectorias en las que la CPU apunta con error
+
+#define HOLD_FRAMES 4   // ticks que una tecla sigue activa tras su último evento
+
+// ===== Modo headless (simulación sin terminal) =====
+// Tamaño del campo simulado y tope de ticks por partida (evita bucles infinitos).
+#define HEADLESS_COLS      80
+#define HEADLESS_LINES     24
+#define HEADLESS_MAX_TICKS 1000000L
+
+// ===== Tipo numérico de la física =====
+// num_t es float por defecto. Con -DPONG_FIXED_POINT es Fixed (Q16.16 sobre int32):
+// solo aritmética entera, así las trayectorias son idénticas bit a bit sin importar
+// compilador, flags de optimización o contracción FMA. Las constantes float se
+// convierten con num_t(x); los lectores (render) usan (int) como con float.
+
+#ifdef PONG_FIXED_POINT
+/** @brief Número en punto fijo Q16.16. (int) trunca hacia 0, igual que con float. */
+struct Fixed {
+    static constexpr int     FRAC_BITS = 16;
+    static constexpr int32_t ONE       = 1 << FRAC_BITS;
+    struct RawTag {};
+
+    int32_t raw;
+
+    Fixed() = default;
+    constexpr Fixed(int v) : raw(v * ONE) {}
+    constexpr explicit Fixed(double v) : raw((int32_t)(v * ONE)) {}
+    constexpr Fixed(int32_t r, RawTag) : raw(r) {}
+    static constexpr Fixed from_raw(int32_t r) { return Fixed(r, RawTag{}); }
+
+    constexpr explicit operator int() const   { return raw / ONE; }
+    constexpr explicit operator float() const { return (float)raw / ONE; }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return from_raw(a.raw + b.raw); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return from_raw(a.raw - b.raw); }
+    friend constexpr Fixed operator-(Fixed a)          { return from_raw(-a.raw); }
+    // Producto y cociente en 64 bits, saturados al rango de int32 (p. ej. distancia / vy
+    // con vy casi 0 debe dar "muy lejos", no un valor envuelto negativo).
+    static constexpr Fixed saturate(int64_t r) {
+        return from_raw(r > INT32_MAX ? INT32_MAX : r < INT32_MIN ? INT32_MIN : (int32_t)r);
+    }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+        return saturate(((int64_t)a.raw * b.raw) >> FRAC_BITS);
+    }
+    friend constexpr Fixed operator/(Fixed a, Fixed b) {
+        return saturate(((int64_t)a.raw * ONE) / b.raw);
+    }
+    Fixed& operator+=(Fixed b) { raw += b.raw; return *this; }
+    Fixed& operator-=(Fixed b) { raw -= b.raw; return *this; }
+    Fixed& operator*=(Fixed b) { return *this = *this * b; }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator< (Fixed a, Fixed b) { return a.raw <  b.raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator> (Fixed a, Fixed b) { return a.raw >  b.raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+};
+typedef Fixed num_t;
+
+/** @brief a mod m en [0, m) (m > 0). */
+static inline num_t num_mod(num_t a, num_t m) {
+    int32_t r = a.raw % m.raw;
+    return num_t::from_raw(r < 0 ? r + m.raw : r);
+}
+
+/** @brief Raíz cuadrada entera (bit a bit) de un Q16.16 no negativo. */
+static inline num_t num_sqrt(num_t a) {
+    if (a.raw <= 0) return num_t(0);
+    uint64_t v = (uint64_t)a.raw << Fixed::FRAC_BITS, r = 0;
+    for (uint64_t bit = 1ull << 62; bit; bit >>= 2) {
+        if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+        else              { r >>= 1; }
+    }
+    return num_t::from_raw((int32_t)r);
+}
+#else
+typedef float num_t;
+
+/** @brief a mod m en [0, m) (m > 0). */
+static inline num_t num_mod(num_t a, num_t m) {
+    float r = fmodf(a, m);
+    return r < 0.0f ? r + m : r;
+}
 
-#define HOLD_FRAMES 4
+/** @brief Raíz cuadrada de un valor no negativo. */
+static inline num_t num_sqrt(num_t a) {
+    return sqrtf(a);
+}
+#endif
 
 // ===== Estado global del juego (structs y enums) =====
 // Ball, Paddle, Score, Entry, Scene, GameMode.
 
 typedef struct {
-    float x, y;
-    float vx, vy;
+    num_t x, y;
+    num_t vx, vy;
 } Ball;
 
 typedef struct {
     int x;
-    float y;
-    float vy;
+    num_t y;
+    num_t vy;
 } Paddle;
 
 typedef struct {
@@ -102,6 +416,10 @@ typedef enum {
     SC_LEADER
 } Scene;
 
+static const char* const SCENE_TRACE_NAME[] = {
+    "escena menu", "escena instrucciones", "escena juego", "escena leaderboard"
+};
+
 // Modos de juego
 typedef enum {
     MODE_PVP = 0,      // Jugador vs Jugador
@@ -109,30 +427,123 @@ typedef enum {
     MODE_CVC           // Computadora vs Computadora
 } GameMode;
 
+// Generador pseudoaleatorio xoshiro128** (estado propio de cada partida).
+typedef struct {
+    uint32_t s[4];
+} Rng;
+
+// Cómo elige la CPU la fila a la que ir cuando la bola viene hacia ella.
+typedef enum {
+    CPU_STRAT_PREDICT = 0,   // llegada exacta con rebotes (cpu_predict_arrival_y)
+    CPU_STRAT_LINEAR,        // recta sin rebotes, recortada al campo
+    CPU_STRAT_TRACK          // sigue la fila actual de la bola (sin predecir)
+} CpuStrategy;
+
+// Parámetros de una IA. El juego usa CPU_DEFAULT_CONFIG; el torneo compara variantes.
+typedef struct {
+    char        name[NAME_MAXLEN+1];
+    int         reaction_delay;   // decide cada reaction_delay ticks
+    float       error_margin;     // filas de error al apuntar
+    int         error_pct;        // % de trayectorias con error
+    CpuStrategy strategy;
+} CpuConfig;
+
+static const CpuConfig CPU_DEFAULT_CONFIG = {
+    "CPU", CPU_REACTION_DELAY, CPU_ERROR_MARGIN, CPU_ERROR_PCT, CPU_STRAT_PREDICT
+};
+
+// Niveles de --difficulty. Tabla generada: regenerar con --calibrate y pegar la salida.
+// Generado por: pong --calibrate --seed 1 (12 generaciones x 16 candidatos x 64 partidas).
+// Última columna: tasa de victorias contra CPU_DEFAULT_CONFIG en 1024 partidas (objetivo),
+// dentro de 2 errores estándar; ningún nivel tiene más retardo ni error que el anterior.
+static const CpuConfig DIFFICULTY_PRESETS[] = {
+    { "facil",    4, 1.552f,  60, CPU_STRAT_PREDICT },   // 0.157 (0.15)
+    { "normal",   1, 1.511f,  24, CPU_STRAT_PREDICT },   // 0.379 (0.35)
+    { "dificil",  1, 1.511f,  19, CPU_STRAT_PREDICT },   // 0.508 (0.50)
+    { "experto",  1, 1.335f,  19, CPU_STRAT_PREDICT },   // 0.801 (0.80)
+};
+
+// IA de las paletas CPU en juego, headless y bench de render (--difficulty; default la de siempre).
+static const CpuConfig* g_cpu_config = &CPU_DEFAULT_CONFIG;
+
+// Estado de una paleta controlada por la CPU.
+typedef struct {
+    const CpuConfig* cfg;
+    Rng      rng;          // errores de la IA (no afecta saques: una repetición no reejecuta la IA)
+    int      delay_counter;
+    unsigned plan_gen;     // traj_gen para el que se calculó el plan (0 = sin plan)
+    num_t    target_y;     // fila de llegada predicha (+ error) de la bola
+    num_t    aim_err;      // error elegido para la trayectoria actual
+} CpuState;
+
+// Estado completo de una partida: objetos, límites del campo y estado de IA.
+// No depende de ncurses ni de hilos; match_step() lo avanza un tick.
+typedef struct {
+    Ball     ball;
+    Paddle   pad1, pad2;
+    Score    score;
+    int      top, bottom, left, right;
+    int      midX;
+    CpuState cpu1;         //paleta izquierda
+    CpuState cpu2;         //paleta derecha
+    Rng      rng;          // saques; reproducible a partir de la semilla
+    uint64_t seed;         // semilla con la que se inició la partida
+    unsigned traj_gen;     // cambia cuando la trayectoria deja de ser predecible (saque, golpe de paleta)
+    long     ticks;
+} Match;
+
 // ===== Flags de control de hilos y entradas =====
 
 static bool g_p1_ai = false;
 static bool g_p2_ai = false;
+// Teclas sostenidas de cada jugador humano (ticks restantes); solo las usa th_sim.
 static int g_p1_hold_up = 0, g_p1_hold_down = 0;
 static int g_p2_hold_up = 0, g_p2_hold_down = 0;
 static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
 static volatile bool g_threads_should_run = false;
-static volatile bool g_paused = false;
+// Atómico: al reiniciar, play_screen prepara g_rec sin g_lock y lo suelta con un store
+// release; th_sim lo lee con acquire antes de tocar g_rec.
+static std::atomic<bool> g_paused{false};
 static volatile bool g_exit_requested = false;
 
-// Entradas
-static volatile int g_p1_up = 0, g_p1_down = 0;
-static volatile int g_p2_up = 0, g_p2_down = 0;
-
 // ===== Objetos del juego y límites del campo =====
+// g_match: partida interactiva (la que dibuja ncurses). El modo headless usa
+// sus propias instancias de Match sin tocar este estado.
 
-static Ball   g_ball;
-static Paddle g_pad1, g_pad2;
-static Score  g_score;
-static int    g_top, g_bottom, g_left, g_right;
-static int    g_midX;
+static Match  g_match;
+static unsigned g_match_gen = 0;   // se incrementa en cada reset_match()
+static uint64_t g_seed = 0;        // semilla base (--seed o time(NULL)); cada partida deriva la suya
 
-static pthread_t th_ball, th_p1, th_p2;
+// ===== Snapshot del mundo para el renderer (triple buffer sin locks) =====
+// El renderer nunca toma g_lock: lee la última WorldSnapshot publicada por th_sim.
+// g_snap_mid guarda el índice del buffer del medio + bit SNAP_DIRTY si es nuevo.
+
+typedef struct {
+    Ball     ball;
+    Paddle   pad1, pad2;
+    Score    score;
+    long     ticks;
+    unsigned gen;      // g_match_gen al publicar
+    bool     paused;
+    uint32_t input_seq; // teclas de paleta aplicadas hasta este tick (g_input_applied)
+} WorldSnapshot;
+
+#define SNAP_INDEX 3u
+#define SNAP_DIRTY 4u
+
+static WorldSnapshot         g_snap_buf[3];
+static std::atomic<unsigned> g_snap_mid{1};
+static unsigned              g_snap_back  = 0;   // solo lo usa el escritor
+static unsigned              g_snap_front = 2;   // solo lo usa el renderer
+static uint32_t              g_input_applied = 0; // teclas aplicadas por th_sim (ver latency_applied)
+
+static pthread_t th_sim;
+
+// Estadísticas del planificador de paso fijo (solo las escribe th_sim).
+static long long g_sim_ticks   = 0;   // deadlines atendidos
+static long long g_sim_late    = 0;   // ticks ejecutados tarde (recuperados en ráfaga)
+static long long g_sim_dropped = 0;   // ticks descartados por atraso excesivo
+static duration<double> time_sim_wall{0};
 
 // Nombres
 static char g_name1[NAME_MAXLEN+1] = "Jugador 1";
@@ -140,8 +551,6 @@ static char g_name2[NAME_MAXLEN+1] = "CPU";
 
 // Modo de juego actual
 static GameMode g_game_mode = MODE_PVP;
-static int g_cpu1_delay_counter = 0;     //paleta izquierda
-static int g_cpu2_delay_counter = 0;     //paleta derecha
 
 /** @brief Limita un float en [mn, mx]. */
 static void clamp_float(float* v, float mn, float mx) {
@@ -149,39 +558,185 @@ static void clamp_float(float* v, float mn, float mx) {
     if (*v > mx) *v = mx;
 }
 
-/** @brief Random uniforme en [a, b]. */
-static float frand_range(float a, float b) {
-    return a + (float)rand() / (float)RAND_MAX * (b - a);
+/** @brief Paso de splitmix64: mezcla una semilla de 64 bits (usado para sembrar Rng). */
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/** @brief Siembra el generador; la misma semilla produce siempre la misma secuencia. */
+static void rng_seed(Rng* r, uint64_t seed) {
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i += 2) {
+        uint64_t v = splitmix64(&x);
+        r->s[i]     = (uint32_t)v;
+        r->s[i + 1] = (uint32_t)(v >> 32);
+    }
+}
+
+/** @brief Rotación a izquierda de 32 bits. */
+static inline uint32_t rotl32(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/** @brief Siguiente valor de 32 bits (xoshiro128**). */
+static uint32_t rng_next(Rng* r) {
+    uint32_t* s = r->s;
+    uint32_t result = rotl32(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl32(s[3], 11);
+    return result;
+}
+
+/** @brief Entero uniforme en [0, n) (n > 0), sin sesgo de módulo apreciable para n chico. */
+static uint32_t rng_below(Rng* r, uint32_t n) {
+    return (uint32_t)(((uint64_t)rng_next(r) * n) >> 32);
+}
+
+/** @brief Semilla de la partida número index derivada de la semilla base. */
+static uint64_t match_seed(uint64_t base, uint64_t index) {
+    uint64_t x = base ^ (index * 0xD1B54A32D192ED03ull);
+    return splitmix64(&x);
+}
+
+/** @brief Random uniforme en [a, b). */
+static num_t frand_range(Rng* r, num_t a, num_t b) {
+#ifdef PONG_FIXED_POINT
+    return a + num_t::from_raw((int32_t)(rng_next(r) >> (32 - Fixed::FRAC_BITS))) * (b - a);
+#else
+    return a + (float)(rng_next(r) >> 8) * (1.0f / 16777216.0f) * (b - a);
+#endif
 }
 
 /** @brief Reposiciona la bola en el centro con velocidad aleatoria hacia un lado.
  *  @param to_right true: sirve a la derecha; false: a la izquierda.
  */
-static void ball_spawn_random(bool to_right) {
-    g_ball.x = (float)((g_left + g_right) / 2);
-    g_ball.y = (float)((g_top  + g_bottom) / 2);
+static void ball_spawn_random(Match* m, bool to_right) {
+    m->ball.x = num_t((m->left + m->right) / 2);
+    m->ball.y = num_t((m->top  + m->bottom) / 2);
 
-    float speed = frand_range(BALL_SPEED_MIN, BALL_SPEED_MAX);
+    num_t speed = frand_range(&m->rng, num_t(BALL_SPEED_MIN), num_t(BALL_SPEED_MAX));
 
-    float angle_y = frand_range(-0.8f, 0.8f);
-    float vx = speed * (to_right ? +1.0f : -1.0f);
-    float vy = speed * 0.6f * angle_y;
+    num_t angle_y = frand_range(&m->rng, num_t(-0.8f), num_t(0.8f));
+    num_t vx = speed * (to_right ? +1 : -1);
+    num_t vy = speed * num_t(0.6f) * angle_y;
 
-    g_ball.vx = vx;
-    g_ball.vy = vy;
+    m->ball.vx = vx;
+    m->ball.vy = vy;
+    m->traj_gen++;
 }
 
 /** @brief Reescala la velocidad manteniendo la dirección. */
-static void ball_scale_speed(float new_speed) {
-    float cur = sqrtf(g_ball.vx * g_ball.vx + g_ball.vy * g_ball.vy);
-    if (cur < 1e-6f) {
-        g_ball.vx = (g_ball.vx >= 0 ? +1.0f : -1.0f) * new_speed;
-        g_ball.vy = 0.0f;
+static void ball_scale_speed(Ball* b, num_t new_speed) {
+    num_t cur = num_sqrt(b->vx * b->vx + b->vy * b->vy);
+    if (cur < num_t(1e-4f)) {
+        b->vx = new_speed * (b->vx >= 0 ? +1 : -1);
+        b->vy = 0;
         return;
     }
-    float k = new_speed / cur;
-    g_ball.vx *= k;
-    g_ball.vy *= k;
+    num_t k = new_speed / cur;
+    b->vx *= k;
+    b->vy *= k;
+}
+
+/** @brief Inicializa una partida para un área de H x W celdas.
+ *  @details Calcula límites, centra paletas, sirve la bola y pone el marcador en 0.
+ *           Toda la aleatoriedad de la partida sale de seed: misma semilla y mismas
+ *           entradas reproducen la partida tick a tick.
+ */
+static void match_init(Match* m, int H, int W, uint64_t seed) {
+    rng_seed(&m->rng, seed);
+    m->seed = seed;
+    m->top = 2;
+    m->bottom = H - 2;
+    m->left = 2;
+    m->right = W - 3;
+    m->midX = W / 2;
+
+    m->pad1.x = m->left + 2;
+    m->pad2.x = m->right - 2;
+    m->pad1.y = (m->top + m->bottom) / 2;
+    m->pad2.y = (m->top + m->bottom) / 2;
+    m->pad1.vy = 0;
+    m->pad2.vy = 0;
+
+    m->traj_gen = 0;
+    ball_spawn_random(m, rng_below(&m->rng, 2));
+
+    m->score.p1 = 0; m->score.p2 = 0;
+    memset(&m->cpu1, 0, sizeof(m->cpu1));
+    memset(&m->cpu2, 0, sizeof(m->cpu2));
+    rng_seed(&m->cpu1.rng, match_seed(seed, 1));
+    rng_seed(&m->cpu2.rng, match_seed(seed, 2));
+    m->cpu1.cfg = g_cpu_config;
+    m->cpu2.cfg = g_cpu_config;
+    m->ticks = 0;
+}
+
+/** @brief true si algún jugador llegó a SCORE_TO_WIN. */
+static bool score_is_final(const Score* s) {
+    return s->p1 >= SCORE_TO_WIN || s->p2 >= SCORE_TO_WIN;
+}
+
+/** @brief true si la partida terminó. */
+static bool match_finished(const Match* m) {
+    return score_is_final(&m->score);
+}
+
+/** @brief Copia objetos y marcador de una partida cualquiera a una snapshot. */
+static void snapshot_from_match(WorldSnapshot* s, const Match* m) {
+    s->ball   = m->ball;
+    s->pad1   = m->pad1;
+    s->pad2   = m->pad2;
+    s->score  = m->score;
+    s->ticks  = m->ticks;
+    s->gen    = 0;
+    s->paused = false;
+    s->input_seq = 0;
+}
+
+/** @brief Copia el estado visible de g_match a una snapshot. */
+static void snapshot_fill(WorldSnapshot* s) {
+    snapshot_from_match(s, &g_match);
+    s->gen    = g_match_gen;
+    s->paused = g_paused;
+    s->input_seq = g_input_applied;
+}
+
+/** @brief Publica el estado actual de g_match para el renderer.
+ *  @details Triple buffer: el escritor (th_sim) llena g_snap_back y lo intercambia
+ *           atómicamente con el del medio marcándolo SNAP_DIRTY. Nunca bloquea.
+ *  @note Llamar con g_lock tomado (lee g_match de forma consistente).
+ */
+static void snapshot_publish(void) {
+    snapshot_fill(&g_snap_buf[g_snap_back]);
+    g_snap_back = g_snap_mid.exchange(g_snap_back | SNAP_DIRTY, std::memory_order_acq_rel) & SNAP_INDEX;
+}
+
+/** @brief Devuelve la snapshot más reciente para el renderer (sin bloquear).
+ *  @details Si hay una publicación nueva, intercambia el buffer frontal con el del medio;
+ *           si no, reutiliza la snapshot anterior.
+ */
+static const WorldSnapshot* snapshot_acquire(void) {
+    if (g_snap_mid.load(std::memory_order_relaxed) & SNAP_DIRTY) {
+        g_snap_front = g_snap_mid.exchange(g_snap_front, std::memory_order_acq_rel) & SNAP_INDEX;
+    }
+    return &g_snap_buf[g_snap_front];
+}
+
+/** @brief Inicializa los tres buffers con g_match. Solo sin th_sim corriendo. */
+static void snapshot_reset(void) {
+    g_snap_back = 0;
+    g_snap_mid.store(1, std::memory_order_relaxed);
+    g_snap_front = 2;
+    for (int i = 0; i < 3; ++i) snapshot_fill(&g_snap_buf[i]);
 }
 
 /** @brief Pantalla de cuenta regresiva y “¡A JUGAR!”. Bloquea ~5 s. */
@@ -225,30 +780,30 @@ static void versus_screen(void) {
 
 /** @brief Dibuja bordes y línea central en una ventana dada (modo WIN). */
 static void draw_borders_and_center_win(WINDOW* w) {
-    mvwaddch(w, g_top,    g_left,  '+');
-    mvwaddch(w, g_top,    g_right, '+');
-    mvwaddch(w, g_bottom, g_left,  '+');
-    mvwaddch(w, g_bottom, g_right, '+');
-
-    for (int x = g_left + 1; x < g_right; ++x) {
-        mvwaddch(w, g_top,    x, '-');
-        mvwaddch(w, g_bottom, x, '-');
+    mvwaddch(w, g_match.top,    g_match.left,  '+');
+    mvwaddch(w, g_match.top,    g_match.right, '+');
+    mvwaddch(w, g_match.bottom, g_match.left,  '+');
+    mvwaddch(w, g_match.bottom, g_match.right, '+');
+
+    for (int x = g_match.left + 1; x < g_match.right; ++x) {
+        mvwaddch(w, g_match.top,    x, '-');
+        mvwaddch(w, g_match.bottom, x, '-');
     }
-    for (int y = g_top + 1; y < g_bottom; ++y) {
-        mvwaddch(w, y, g_left,  '|');
-        mvwaddch(w, y, g_right, '|');
+    for (int y = g_match.top + 1; y < g_match.bottom; ++y) {
+        mvwaddch(w, y, g_match.left,  '|');
+        mvwaddch(w, y, g_match.right, '|');
     }
-    for (int y = g_top + 1; y < g_bottom; y += 2) {
-        mvwaddch(w, y, g_midX, ':');
+    for (int y = g_match.top + 1; y < g_match.bottom; y += 2) {
+        mvwaddch(w, y, g_match.midX, ':');
     }
 }
 
 /** @brief Dibuja el HUD (título + marcador + tips) en una ventana dada. */
-static void draw_score_win(WINDOW* w) {
+static void draw_score_win(WINDOW* w, const WorldSnapshot* s) {
     int H, W; getmaxyx(w, H, W);
-    mvwprintw(w, 0, 2, "%s: %d", g_name1, g_score.p1);
+    mvwprintw(w, 0, 2, "%s: %d", g_name1, s->score.p1);
     char right_buf[64];
-    snprintf(right_buf, sizeof(right_buf), "%s: %d", g_name2, g_score.p2);
+    snprintf(right_buf, sizeof(right_buf), "%s: %d", g_name2, s->score.p2);
     mvwprintw(w, 0, W - (int)strlen(right_buf) - 2, "%s", right_buf);
 
     wattron(w, A_BOLD | COLOR_PAIR(5));
@@ -260,56 +815,317 @@ static void draw_score_win(WINDOW* w) {
 }
 
 /** @brief Dibuja paletas y bola en una ventana dada. */
-static void draw_paddles_and_ball_win(WINDOW* w) {
-    int y1 = (int)g_pad1.y;
+static void draw_paddles_and_ball_win(WINDOW* w, const WorldSnapshot* s) {
+    int y1 = (int)s->pad1.y;
     wattron(w, COLOR_PAIR(2) | A_BOLD);
     for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
         int yy = y1 + k;
-        if (yy > g_top && yy < g_bottom) mvwaddch(w, yy, g_pad1.x, '|');
+        if (yy > g_match.top && yy < g_match.bottom) mvwaddch(w, yy, s->pad1.x, '|');
     }
     wattroff(w, COLOR_PAIR(2) | A_BOLD);
 
-    int y2 = (int)g_pad2.y;
+    int y2 = (int)s->pad2.y;
     wattron(w, COLOR_PAIR(3) | A_BOLD);
     for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
         int yy = y2 + k;
-        if (yy > g_top && yy < g_bottom) mvwaddch(w, yy, g_pad2.x, '|');
+        if (yy > g_match.top && yy < g_match.bottom) mvwaddch(w, yy, s->pad2.x, '|');
     }
     wattroff(w, COLOR_PAIR(3) | A_BOLD);
 
     wattron(w, COLOR_PAIR(1) | A_BOLD);
-    mvwaddch(w, (int)g_ball.y, (int)g_ball.x, 'O');
+    mvwaddch(w, (int)s->ball.y, (int)s->ball.x, 'O');
     wattroff(w, COLOR_PAIR(1) | A_BOLD);
 }
 
-/** @brief Inicializa límites, paletas, bola, marcador y crea ventanas.
- *  @details
- *   - g_win_static se dibuja una sola vez con bordes/centro.
- *   - g_win_dynamic se usará cada frame (no se hace clear total del stdscr).
+// ===== Renderer incremental (solo celdas que cambian) =====
+// Recuerda qué se dibujó en el frame anterior y solo repinta las celdas que
+// cambiaron; el fondo (bordes y ':') se restaura leyendo g_win_static.
+
+typedef struct {
+    bool valid;            // false: el próximo frame repinta todo
+    int  ball_y, ball_x;
+    int  pad1_y, pad2_y;   // fila central de cada paleta
+    int  score1, score2;
+    bool paused;
+} RenderState;
+
+static RenderState g_rs;
+
+/** @brief true si la fila yy queda dentro de una paleta centrada en y y visible en el campo. */
+static bool paddle_covers(int y, int yy) {
+    return yy >= y - PADDLE_LEN/2 && yy <= y + PADDLE_LEN/2 &&
+           yy > g_match.top && yy < g_match.bottom;
+}
+
+/** @brief Repinta una celda con lo que le corresponde sin la bola: paleta o fondo estático. */
+static void restore_cell(WINDOW* w, int y, int x, const WorldSnapshot* s) {
+    if (x == s->pad1.x && paddle_covers((int)s->pad1.y, y)) {
+        mvwaddch(w, y, x, '|' | COLOR_PAIR(2) | A_BOLD);
+    } else if (x == s->pad2.x && paddle_covers((int)s->pad2.y, y)) {
+        mvwaddch(w, y, x, '|' | COLOR_PAIR(3) | A_BOLD);
+    } else {
+        mvwaddch(w, y, x, mvwinch(g_win_static, y, x));
+    }
+}
+
+/** @brief Mueve una paleta de la fila old_y a new_y tocando solo las celdas que difieren. */
+static void repaint_paddle(WINDOW* w, int x, int old_y, int new_y, chtype glyph,
+                           const WorldSnapshot* s) {
+    if (old_y == new_y) return;
+    for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
+        int yy = old_y + k;
+        if (paddle_covers(old_y, yy) && !paddle_covers(new_y, yy)) restore_cell(w, yy, x, s);
+    }
+    for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
+        int yy = new_y + k;
+        if (paddle_covers(new_y, yy) && !paddle_covers(old_y, yy)) mvwaddch(w, yy, x, glyph);
+    }
+}
+
+/** @brief Dibuja un frame en w repintando solo lo que cambió desde el anterior.
+ *  @details Si g_rs no es válido (inicio o reinicio), copia el fondo estático y
+ *           dibuja todo una vez. Luego: paletas, bola, marcador y PAUSA por diferencia.
  */
-static void reset_world() {
-    int H, W;
-    getmaxyx(stdscr, H, W);
-    g_pad1.vy = 0.0f;
-    g_pad2.vy = 0.0f;
+static void render_dirty(WINDOW* w, const WorldSnapshot* s) {
+    const int pause_y = (g_match.top + g_match.bottom)/2;
+    const int pause_x = g_match.midX - 2;
+    const int ball_y = (int)s->ball.y, ball_x = (int)s->ball.x;
+    const int pad1_y = (int)s->pad1.y, pad2_y = (int)s->pad2.y;
+
+    if (!g_rs.valid) {
+        overwrite(g_win_static, w);
+        draw_score_win(w, s);
+        draw_paddles_and_ball_win(w, s);
+        g_rs.paused = false;
+    } else {
+        repaint_paddle(w, s->pad1.x, g_rs.pad1_y, pad1_y, '|' | COLOR_PAIR(2) | A_BOLD, s);
+        repaint_paddle(w, s->pad2.x, g_rs.pad2_y, pad2_y, '|' | COLOR_PAIR(3) | A_BOLD, s);
+
+        if (ball_y != g_rs.ball_y || ball_x != g_rs.ball_x) {
+            restore_cell(w, g_rs.ball_y, g_rs.ball_x, s);
+        }
 
-    g_top = 2;
-    g_bottom = H - 2;
-    g_left = 2;
-    g_right = W - 3;
-    g_midX = W / 2;
+        if (s->score.p1 != g_rs.score1 || s->score.p2 != g_rs.score2) {
+            // El ancho del marcador puede cambiar (9 -> 10): limpia la fila del HUD.
+            wmove(w, 0, 0);
+            wclrtoeol(w);
+            draw_score_win(w, s);
+        }
+
+        if (g_rs.paused && !s->paused) {
+            for (int i = 0; i < 5; ++i) restore_cell(w, pause_y, pause_x + i, s);
+        }
+        // La bola siempre al final: una restauración de paleta pudo taparla.
+        mvwaddch(w, ball_y, ball_x, 'O' | COLOR_PAIR(1) | A_BOLD);
+    }
 
-    g_pad1.x = g_left + 2;
-    g_pad2.x = g_right - 2;
-    g_pad1.y = (g_top + g_bottom) / 2;
-    g_pad2.y = (g_top + g_bottom) / 2;
+    if (s->paused && !g_rs.paused) {
+        wattron(w, A_BOLD);
+        mvwprintw(w, pause_y, pause_x, "PAUSA");
+        wattroff(w, A_BOLD);
+    }
+
+    g_rs.valid  = true;
+    g_rs.ball_y = ball_y;  g_rs.ball_x = ball_x;
+    g_rs.pad1_y = pad1_y;  g_rs.pad2_y = pad2_y;
+    g_rs.score1 = s->score.p1;
+    g_rs.score2 = s->score.p2;
+    g_rs.paused = s->paused;
+}
 
-    ball_spawn_random(rand() % 2); 
+// ===== Backend ANSI (framebuffer propio + diff, sin ncurses) =====
+// Mantiene una grilla de celdas (glifo + COLOR_PAIR + negrita). Cada frame se
+// pinta completo en memoria, se compara con el anterior y los cambios salen en
+// un solo write() de secuencias de cursor y SGR. Sirve contra una tty, un pipe
+// o /dev/null (ver --render-bench).
 
-    g_score.p1 = 0; g_score.p2 = 0;
-    g_paused = false;
-    g_cpu1_delay_counter = 0;
-    g_cpu2_delay_counter = 0;
+typedef struct {
+    char          glyph;
+    unsigned char pair;    // índice de COLOR_PAIR (0 = colores por defecto)
+    unsigned char bold;
+} Cell;
+
+typedef struct {
+    int       fd;
+    int       rows, cols;
+    Cell*     cur;         // frame en construcción
+    Cell*     prev;        // lo que muestra el terminal
+    bool      prev_valid;  // false: el próximo present limpia y repinta todo
+    char*     out;
+    size_t    out_len, out_cap;
+    long long frames, writes, bytes;
+} AnsiFb;
+
+typedef enum {
+    RENDER_CURSES = 0,
+    RENDER_ANSI
+} RenderBackend;
+
+static RenderBackend g_render_backend = RENDER_CURSES;
+static AnsiFb        g_fb;
+
+// Colores SGR equivalentes a los init_pair() de main().
+static const char* const ANSI_PAIR_SGR[] = {
+    "39;49", "32;49", "31;49", "34;49", "33;49", "35;49", "37;40"
+};
+
+/** @brief Reserva las grillas para rows x cols celdas. @return false si no hay memoria. */
+static bool ansi_fb_init(AnsiFb* fb, int fd, int rows, int cols) {
+    memset(fb, 0, sizeof(*fb));
+    fb->fd = fd;
+    fb->rows = rows;
+    fb->cols = cols;
+    fb->cur  = (Cell*)calloc((size_t)rows * cols, sizeof(Cell));
+    fb->prev = (Cell*)calloc((size_t)rows * cols, sizeof(Cell));
+    // Peor caso por celda: movimiento de cursor + SGR + glifo (~24 bytes).
+    fb->out_cap = (size_t)rows * cols * 24 + 64;
+    fb->out  = (char*)malloc(fb->out_cap);
+    return fb->cur && fb->prev && fb->out;
+}
+
+/** @brief Libera las grillas y el buffer de salida. */
+static void ansi_fb_free(AnsiFb* fb) {
+    free(fb->cur);
+    free(fb->prev);
+    free(fb->out);
+    fb->cur = fb->prev = NULL;
+    fb->out = NULL;
+}
+
+/** @brief Llena el frame en construcción con espacios sin color. */
+static void ansi_fb_clear(AnsiFb* fb) {
+    Cell blank = { ' ', 0, 0 };
+    for (int i = 0; i < fb->rows * fb->cols; ++i) fb->cur[i] = blank;
+}
+
+/** @brief Escribe un glifo en (y, x); ignora coordenadas fuera de la grilla. */
+static void ansi_fb_put(AnsiFb* fb, int y, int x, char glyph, int pair, bool bold) {
+    if (y < 0 || y >= fb->rows || x < 0 || x >= fb->cols) return;
+    Cell* c = &fb->cur[y * fb->cols + x];
+    c->glyph = glyph;
+    c->pair  = (unsigned char)pair;
+    c->bold  = bold ? 1 : 0;
+}
+
+/** @brief Escribe un texto a partir de (y, x). */
+static void ansi_fb_print(AnsiFb* fb, int y, int x, const char* text, int pair, bool bold) {
+    for (int i = 0; text[i]; ++i) ansi_fb_put(fb, y, x + i, text[i], pair, bold);
+}
+
+/** @brief Agrega bytes al buffer de salida (el tamaño se reservó en init). */
+static void ansi_fb_emit(AnsiFb* fb, const char* data, size_t n) {
+    memcpy(fb->out + fb->out_len, data, n);
+    fb->out_len += n;
+}
+
+/** @brief Compara cur con prev y manda solo las celdas distintas en un write().
+ *  @details Evita mover el cursor si la celda sigue a la anterior y repite SGR
+ *           solo cuando cambian color o negrita.
+ */
+static void ansi_fb_present(AnsiFb* fb) {
+    fb->out_len = 0;
+    if (!fb->prev_valid) {
+        ansi_fb_emit(fb, "\x1b[0m\x1b[2J", 8);
+        Cell blank = { ' ', 0, 0 };
+        for (int i = 0; i < fb->rows * fb->cols; ++i) fb->prev[i] = blank;
+        fb->prev_valid = true;
+    }
+
+    int cy = -1, cx = -1;        // posición conocida del cursor
+    int cpair = -1, cbold = -1;  // SGR activo
+    char seq[32];
+    for (int y = 0; y < fb->rows; ++y) {
+        for (int x = 0; x < fb->cols; ++x) {
+            int i = y * fb->cols + x;
+            Cell c = fb->cur[i];
+            Cell p = fb->prev[i];
+            if (c.glyph == p.glyph && c.pair == p.pair && c.bold == p.bold) continue;
+
+            if (y != cy || x != cx) {
+                int n = snprintf(seq, sizeof(seq), "\x1b[%d;%dH", y + 1, x + 1);
+                ansi_fb_emit(fb, seq, (size_t)n);
+            }
+            if (c.pair != cpair || c.bold != cbold) {
+                int n = snprintf(seq, sizeof(seq), "\x1b[%s;%sm",
+                                 c.bold ? "1" : "22", ANSI_PAIR_SGR[c.pair]);
+                ansi_fb_emit(fb, seq, (size_t)n);
+                cpair = c.pair;
+                cbold = c.bold;
+            }
+            ansi_fb_emit(fb, &c.glyph, 1);
+            fb->prev[i] = c;
+            cy = y;
+            cx = x + 1;
+        }
+    }
+
+    size_t off = 0;
+    while (off < fb->out_len) {
+        ssize_t w = write(fb->fd, fb->out + off, fb->out_len - off);
+        fb->writes++;
+        if (w <= 0) break;
+        off += (size_t)w;
+    }
+    fb->bytes += (long long)off;
+    fb->frames++;
+}
+
+/** @brief Pinta un frame completo (cancha, HUD, paletas, bola, pausa) en la grilla.
+ *  @param field partida de la que se toman los límites del campo.
+ */
+static void ansi_draw_world(AnsiFb* fb, const Match* field, const WorldSnapshot* s) {
+    const int W = fb->cols;
+    ansi_fb_clear(fb);
+
+    // Cancha
+    for (int x = field->left + 1; x < field->right; ++x) {
+        ansi_fb_put(fb, field->top,    x, '-', 0, false);
+        ansi_fb_put(fb, field->bottom, x, '-', 0, false);
+    }
+    for (int y = field->top + 1; y < field->bottom; ++y) {
+        ansi_fb_put(fb, y, field->left,  '|', 0, false);
+        ansi_fb_put(fb, y, field->right, '|', 0, false);
+    }
+    ansi_fb_put(fb, field->top,    field->left,  '+', 0, false);
+    ansi_fb_put(fb, field->top,    field->right, '+', 0, false);
+    ansi_fb_put(fb, field->bottom, field->left,  '+', 0, false);
+    ansi_fb_put(fb, field->bottom, field->right, '+', 0, false);
+    for (int y = field->top + 1; y < field->bottom; y += 2) {
+        ansi_fb_put(fb, y, field->midX, ':', 0, false);
+    }
+
+    // HUD
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s: %d", g_name1, s->score.p1);
+    ansi_fb_print(fb, 0, 2, buf, 0, false);
+    snprintf(buf, sizeof(buf), "%s: %d", g_name2, s->score.p2);
+    ansi_fb_print(fb, 0, W - (int)strlen(buf) - 2, buf, 0, false);
+    ansi_fb_print(fb, 0, (W - (int)strlen("PONG")) / 2, "PONG", 5, true);
+    const char* instr = "(P: pausa, Q: menu)";
+    ansi_fb_print(fb, 1, (W - (int)strlen(instr)) / 2, instr, 0, false);
+
+    // Paletas y bola
+    for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
+        int yy = (int)s->pad1.y + k;
+        if (yy > field->top && yy < field->bottom) ansi_fb_put(fb, yy, s->pad1.x, '|', 2, true);
+        yy = (int)s->pad2.y + k;
+        if (yy > field->top && yy < field->bottom) ansi_fb_put(fb, yy, s->pad2.x, '|', 3, true);
+    }
+    ansi_fb_put(fb, (int)s->ball.y, (int)s->ball.x, 'O', 1, true);
+
+    if (s->paused) {
+        ansi_fb_print(fb, (field->top + field->bottom)/2, field->midX - 2, "PAUSA", 0, true);
+    }
+}
+
+/** @brief (Re)crea g_win_static/g_win_dynamic de H x W e invalida el estado de los renderers.
+ *  @details
+ *   - g_win_static se dibuja una sola vez con bordes/centro y queda como fondo de referencia.
+ *   - g_win_dynamic es lo que se muestra; render_dirty() lo parchea celda por celda.
+ */
+static void create_field_windows(int H, int W) {
+    g_rs.valid = false;
+    g_fb.prev_valid = false;
 
     if (g_win_static)  { delwin(g_win_static);  g_win_static  = NULL; }
     if (g_win_dynamic) { delwin(g_win_dynamic); g_win_dynamic = NULL; }
@@ -324,25 +1140,42 @@ static void reset_world() {
     doupdate();
 }
 
+/** @brief Partida nueva en g_match (límites, paletas, bola, marcador). Sin E/S de terminal. */
+static void reset_match(void) {
+    int H, W;
+    getmaxyx(stdscr, H, W);
+    match_init(&g_match, H, W, match_seed(g_seed, g_match_gen));
+    g_match_gen++;
+}
+
+/** @brief Inicializa límites, paletas, bola, marcador y crea ventanas. */
+static void reset_world() {
+    int H, W;
+    getmaxyx(stdscr, H, W);
+    reset_match();
+    g_paused = false;
+    create_field_windows(H, W);
+}
+
 /** @brief (Versión legacy) Dibuja bordes/centro en stdscr. */
 static void draw_borders_and_center() {
-    mvaddch(g_top, g_left, '+');
-    mvaddch(g_top, g_right, '+');
-    mvaddch(g_bottom, g_left, '+');
-    mvaddch(g_bottom, g_right, '+');
+    mvaddch(g_match.top, g_match.left, '+');
+    mvaddch(g_match.top, g_match.right, '+');
+    mvaddch(g_match.bottom, g_match.left, '+');
+    mvaddch(g_match.bottom, g_match.right, '+');
   
-    for (int x = g_left + 1; x < g_right; ++x) {
-        mvaddch(g_top, x, '-');
-        mvaddch(g_bottom, x, '-');
+    for (int x = g_match.left + 1; x < g_match.right; ++x) {
+        mvaddch(g_match.top, x, '-');
+        mvaddch(g_match.bottom, x, '-');
     }
 
-    for (int y = g_top + 1; y < g_bottom; ++y) {
-        mvaddch(y, g_left, '|');
-        mvaddch(y, g_right, '|');
+    for (int y = g_match.top + 1; y < g_match.bottom; ++y) {
+        mvaddch(y, g_match.left, '|');
+        mvaddch(y, g_match.right, '|');
     }
 
-    for (int y = g_top + 1; y < g_bottom; y += 2) {
-        mvaddch(y, g_midX, ':');
+    for (int y = g_match.top + 1; y < g_match.bottom; y += 2) {
+        mvaddch(y, g_match.midX, ':');
     }
 }
 
@@ -350,10 +1183,10 @@ static void draw_borders_and_center() {
 static void draw_score() {
     int H, W;
     getmaxyx(stdscr, H, W);
-    mvprintw(0, 2, "%s: %d", g_name1, g_score.p1);
+    mvprintw(0, 2, "%s: %d", g_name1, g_match.score.p1);
 
     char right_buf[64];
-    snprintf(right_buf, sizeof(right_buf), "%s: %d", g_name2, g_score.p2);
+    snprintf(right_buf, sizeof(right_buf), "%s: %d", g_name2, g_match.score.p2);
     mvprintw(0, W - strlen(right_buf) - 2, "%s", right_buf);
 
     attron(A_BOLD | COLOR_PAIR(5));
@@ -366,302 +1199,2948 @@ static void draw_score() {
 
 /** @brief (Legacy) Dibuja paletas y bola en stdscr. */
 static void draw_paddles_and_ball() {
-    int y1 = (int)g_pad1.y;
+    int y1 = (int)g_match.pad1.y;
     attron(COLOR_PAIR(2) | A_BOLD);
     for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
         int yy = y1 + k;
-        if (yy > g_top && yy < g_bottom) mvaddch(yy, g_pad1.x, '|');
+        if (yy > g_match.top && yy < g_match.bottom) mvaddch(yy, g_match.pad1.x, '|');
     }
     attroff(COLOR_PAIR(2) | A_BOLD);
 
-    int y2 = (int)g_pad2.y;
+    int y2 = (int)g_match.pad2.y;
     attron(COLOR_PAIR(3) | A_BOLD);
     for (int k = -PADDLE_LEN/2; k <= PADDLE_LEN/2; ++k) {
         int yy = y2 + k;
-        if (yy > g_top && yy < g_bottom) mvaddch(yy, g_pad2.x, '|');
+        if (yy > g_match.top && yy < g_match.bottom) mvaddch(yy, g_match.pad2.x, '|');
     }
     attroff(COLOR_PAIR(3) | A_BOLD);
 
     attron(COLOR_PAIR(1) | A_BOLD);
-    mvaddch((int)g_ball.y, (int)g_ball.x, 'O');
+    mvaddch((int)g_match.ball.y, (int)g_match.ball.x, 'O');
     attroff(COLOR_PAIR(1) | A_BOLD);
 }
 
-/** @brief Dibuja un item de menú centrado con “caja” y resaltado opcional. */
-void draw_menu_item(int y, int W, const char* text, bool selected) {
-    int len = strlen(text);
-    int box_w = len + 8; 
-    int x = (W - box_w) / 2;
-    int inner_w = box_w - 2;
-    int left_pad = (inner_w - len) / 2;
-    int right_pad = inner_w - len - left_pad;
+/** @brief Dibuja un item de menú centrado con “caja” y resaltado opcional. */
+void draw_menu_item(int y, int W, const char* text, bool selected) {
+    int len = strlen(text);
+    int box_w = len + 8; 
+    int x = (W - box_w) / 2;
+    int inner_w = box_w - 2;
+    int left_pad = (inner_w - len) / 2;
+    int right_pad = inner_w - len - left_pad;
+
+    if (selected) attron(A_REVERSE);
+    mvprintw(y, x, "+-%.*s-+", inner_w, "--------------------------------");
+    mvprintw(y+1, x, "|%*s%s%*s|", left_pad, "", text, right_pad, "");
+    mvprintw(y+2, x, "+-%.*s-+", inner_w, "--------------------------------");
+
+    if (selected) attroff(A_REVERSE);
+}
+
+/** @brief Crea el archivo de puntajes si no existe. */
+static void ensure_file_exists() {
+    FILE* f = fopen(LEADERBOARD_FILE, "a");
+    if (f) fclose(f);
+}
+
+/** @brief Ordena Entry por score ganador y fecha (desc). */
+static int cmp_entry(const void* a, const void* b) {
+    const Entry* ea = (const Entry*)a;
+    const Entry* eb = (const Entry*)b;
+    if (eb->winScore != ea->winScore) return eb->winScore - ea->winScore;
+    if (eb->ts > ea->ts) return 1;
+    if (eb->ts < ea->ts) return -1;
+    return 0;
+}
+
+/** @brief Parsea una fila "ganador,perdedor,ws,ls,ts\n" del CSV.
+ *  @return false si está mal formada o incompleta (sin '\n': otro proceso la está escribiendo).
+ */
+static bool parse_entry_line(const char* line, Entry* e) {
+    if (!strchr(line, '\n')) return false;
+    long ts;
+    if (sscanf(line, "%24[^,],%24[^,],%d,%d,%ld",
+               e->winner, e->loser, &e->winScore, &e->loseScore, &ts) != 5) return false;
+    e->ts = (time_t)ts;
+    return true;
+}
+
+// Candidato del top-K: seq (número de fila) desempata a favor de la fila más nueva.
+typedef struct {
+    Entry e;
+    long  seq;
+} TopKSlot;
+
+/** @brief true si a va antes que b en el ranking (cmp_entry y luego fila más nueva). */
+static bool topk_before(const TopKSlot* a, const TopKSlot* b) {
+    int c = cmp_entry(&a->e, &b->e);
+    return c != 0 ? c < 0 : a->seq > b->seq;
+}
+
+/** @brief Baja heap[i] en un heap cuya raíz es el peor candidato retenido. */
+static void topk_sift_down(TopKSlot* heap, int n, int i) {
+    while (1) {
+        int l = 2*i + 1, r = l + 1, worst = i;
+        if (l < n && topk_before(&heap[worst], &heap[l])) worst = l;
+        if (r < n && topk_before(&heap[worst], &heap[r])) worst = r;
+        if (worst == i) return;
+        TopKSlot t = heap[i]; heap[i] = heap[worst]; heap[worst] = t;
+        i = worst;
+    }
+}
+
+/** @brief Top k del historial CSV completo en una sola lectura secuencial.
+ *  @details Heap acotado de k candidatos (memoria constante): cada fila solo
+ *           entra si supera al peor retenido. Las filas mal formadas se saltan.
+ *  @return número de entradas en out, ya ordenadas como cmp_entry.
+ */
+static int load_top_entries(Entry* out, int k) {
+    if (k <= 0) return 0;
+    ensure_file_exists();
+    FILE* f = fopen(LEADERBOARD_FILE, "r");
+    if (!f) return 0;
+
+    TopKSlot heap[LEADERBOARD_TOP];
+    if (k > LEADERBOARD_TOP) k = LEADERBOARD_TOP;
+    int n = 0;
+    long seq = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        TopKSlot c;
+        if (!parse_entry_line(line, &c.e)) continue;
+        c.seq = seq++;
+        if (n < k) {
+            // Inserta y sube mientras sea peor que su padre.
+            int i = n++;
+            heap[i] = c;
+            while (i > 0 && topk_before(&heap[(i-1)/2], &heap[i])) {
+                TopKSlot t = heap[i]; heap[i] = heap[(i-1)/2]; heap[(i-1)/2] = t;
+                i = (i-1)/2;
+            }
+        } else if (topk_before(&c, &heap[0])) {
+            heap[0] = c;
+            topk_sift_down(heap, n, 0);
+        }
+    }
+    fclose(f);
+
+    // Heapsort in situ sobre el mismo heap (n <= k <= LEADERBOARD_TOP): la raíz es el
+    // peor, así que al mandarla al final queda ordenado de mejor a peor.
+    for (int end = n - 1; end > 0; --end) {
+        TopKSlot t = heap[0]; heap[0] = heap[end]; heap[end] = t;
+        topk_sift_down(heap, end, 0);
+    }
+    for (int i = 0; i < n; ++i) out[i] = heap[i].e;
+    return n;
+}
+
+/** @brief Agrega n entradas al historial CSV en un solo write() con O_APPEND.
+ *  @details Una sola escritura evita que otro proceso intercale líneas a medias.
+ *  @param durable true: fsync antes de cerrar.
+ */
+static void append_entries_csv(const Entry* es, int n, bool durable) {
+    int fd = open(LEADERBOARD_FILE, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return;
+    char buf[LB_QUEUE_CAP * 96];
+    size_t len = 0;
+    for (int i = 0; i < n; ++i) {
+        const Entry* e = &es[i];
+        int w = snprintf(buf + len, sizeof(buf) - len, "%s,%s,%d,%d,%ld\n",
+                         e->winner, e->loser, e->winScore, e->loseScore, (long)e->ts);
+        if (w < 0 || (size_t)w >= sizeof(buf) - len) break;
+        len += (size_t)w;
+    }
+    if (write(fd, buf, len) < 0) { /* sin espacio / sin permisos: se pierde la fila CSV */ }
+    if (durable) fsync(fd);
+    close(fd);
+}
+
+// ===== Leaderboard binario multi-proceso (journal + snapshot compactado) =====
+// LEADERBOARD_JNL : LbJournalRec[] solo-append. Cada registro lleva la generación
+//                   del snapshot al que se suma y un CRC32; los rotos se ignoran.
+// LEADERBOARD_SNAP: LbSnapHeader + LbRecord[count] ordenados como cmp_entry
+//                   (empate exacto: el más nuevo primero).
+// Escritores: flock(LOCK_EX) sobre el journal para agregar, importar y compactar.
+// Lectores: sin locks. mmap del snapshot (se reemplaza con rename(), nunca se
+// modifica en su lugar) + registros del journal de su misma generación.
+
+#define LB_SNAP_MAGIC "PONGSN1"
+#define LB_VERSION    2
+
+typedef struct {
+    char    winner[32];
+    char    loser[32];
+    int32_t winScore;
+    int32_t loseScore;
+    int64_t ts;
+} LbRecord;
+
+typedef struct {
+    LbRecord rec;
+    uint32_t gen;          // generación del snapshot al que pertenece
+    uint32_t crc;          // CRC32 de rec + gen
+} LbJournalRec;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t gen;          // los registros del journal con esta gen van encima
+    uint64_t count;
+    uint64_t reserved;
+} LbSnapHeader;
+
+// Vista de solo lectura: snapshot mapeado + cola del journal ya ordenada.
+typedef struct {
+    LbSnapHeader* snap;
+    size_t        snap_len;
+    LbRecord*     tail;
+    long          tail_n;
+} LbView;
+
+// Tabla del CRC32 armada en compilación: la usan el escritor del leaderboard y el hilo
+// principal sin sincronizarse, así que no puede inicializarse perezosamente.
+struct Crc32Table {
+    uint32_t v[256];
+    constexpr Crc32Table() : v() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            v[i] = c;
+        }
+    }
+};
+static constexpr Crc32Table CRC32_TABLE{};
+
+/** @brief CRC32 (IEEE, polinomio reflejado 0xEDB88320). */
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t n) {
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = CRC32_TABLE.v[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t journal_crc(const LbJournalRec* j) {
+    return crc32_update(0, j, offsetof(LbJournalRec, crc));
+}
+
+/** @brief Orden del leaderboard entre dos registros (misma regla que cmp_entry). */
+static int cmp_record(const LbRecord* a, const LbRecord* b) {
+    if (b->winScore != a->winScore) return b->winScore - a->winScore;
+    if (b->ts > a->ts) return 1;
+    if (b->ts < a->ts) return -1;
+    return 0;
+}
+
+static void record_from_entry(LbRecord* r, const Entry* e) {
+    memset(r, 0, sizeof(*r));
+    snprintf(r->winner, sizeof(r->winner), "%s", e->winner);
+    snprintf(r->loser,  sizeof(r->loser),  "%s", e->loser);
+    r->winScore  = e->winScore;
+    r->loseScore = e->loseScore;
+    r->ts        = (int64_t)e->ts;
+}
+
+static void entry_from_record(Entry* e, const LbRecord* r) {
+    // Los registros salen de un Entry: el nombre nunca pasa de NAME_MAXLEN.
+    snprintf(e->winner, sizeof(e->winner), "%.*s", NAME_MAXLEN, r->winner);
+    snprintf(e->loser,  sizeof(e->loser),  "%.*s", NAME_MAXLEN, r->loser);
+    e->winScore  = r->winScore;
+    e->loseScore = r->loseScore;
+    e->ts        = (time_t)r->ts;
+}
+
+/** @brief Ordena registros en orden de llegada dejando primero al más nuevo en empates. */
+static void lb_sort_newest_first(LbRecord* recs, long n) {
+    std::reverse(recs, recs + n);
+    std::stable_sort(recs, recs + n, [](const LbRecord& a, const LbRecord& b) {
+        return cmp_record(&a, &b) < 0;
+    });
+}
+
+/** @brief Lee el encabezado del snapshot actual. @return false si no existe o es inválido. */
+static bool lb_snap_header(LbSnapHeader* h) {
+    int fd = open(LEADERBOARD_SNAP, O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = pread(fd, h, sizeof(*h), 0) == (ssize_t)sizeof(*h) &&
+              memcmp(h->magic, LB_SNAP_MAGIC, 8) == 0 && h->version == LB_VERSION;
+    close(fd);
+    return ok;
+}
+
+/** @brief Mapea el snapshot completo en modo lectura. @return NULL si no hay uno válido. */
+static LbSnapHeader* lb_snap_map(size_t* len, ino_t* ino) {
+    int fd = open(LEADERBOARD_SNAP, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat sb;
+    LbSnapHeader* h = NULL;
+    if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(LbSnapHeader)) {
+        void* p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            h = (LbSnapHeader*)p;
+            *len = (size_t)sb.st_size;
+            *ino = sb.st_ino;
+            if (memcmp(h->magic, LB_SNAP_MAGIC, 8) != 0 || h->version != LB_VERSION ||
+                sizeof(LbSnapHeader) + h->count * sizeof(LbRecord) > *len) {
+                munmap(p, *len);
+                h = NULL;
+            }
+        }
+    }
+    close(fd);
+    return h;
+}
+
+static const LbRecord* lb_snap_records(const LbSnapHeader* h) { return (const LbRecord*)(h + 1); }
+
+/** @brief Escribe un snapshot nuevo en un temporal y lo publica con rename() atómico. */
+static bool lb_write_snapshot(const LbRecord* recs, uint64_t n, uint32_t gen) {
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", LEADERBOARD_SNAP, (int)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    LbSnapHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LB_SNAP_MAGIC, 8);
+    h.version = LB_VERSION;
+    h.gen = gen;
+    h.count = n;
+    bool ok = write(fd, &h, sizeof(h)) == (ssize_t)sizeof(h);
+    size_t bytes = (size_t)n * sizeof(LbRecord);
+    size_t off = 0;
+    while (ok && off < bytes) {
+        ssize_t w = write(fd, (const char*)recs + off, bytes - off);
+        if (w <= 0) ok = false; else off += (size_t)w;
+    }
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp, LEADERBOARD_SNAP) != 0) {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+/** @brief Lee los registros válidos (CRC correcto) de la generación gen del journal.
+ *  @param out arreglo nuevo (malloc) en orden de llegada; el llamador lo libera.
+ *  @return cantidad de registros, o -1 si falla la lectura.
+ */
+static long lb_read_journal(int fd, uint32_t gen, LbRecord** out) {
+    *out = NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) return -1;
+    size_t n_all = (size_t)sb.st_size / sizeof(LbJournalRec);
+    if (n_all == 0) return 0;
+    LbJournalRec* raw = (LbJournalRec*)malloc(n_all * sizeof(LbJournalRec));
+    if (!raw) return -1;
+    ssize_t got = pread(fd, raw, n_all * sizeof(LbJournalRec), 0);
+    if (got < 0) { free(raw); return -1; }
+    n_all = (size_t)got / sizeof(LbJournalRec);
+
+    LbRecord* recs = (LbRecord*)malloc((n_all ? n_all : 1) * sizeof(LbRecord));
+    if (!recs) { free(raw); return -1; }
+    long n = 0;
+    for (size_t i = 0; i < n_all; ++i) {
+        if (raw[i].gen == gen && raw[i].crc == journal_crc(&raw[i])) recs[n++] = raw[i].rec;
+    }
+    free(raw);
+    *out = recs;
+    return n;
+}
+
+/** @brief Abre el journal y toma el lock exclusivo de escritores. @return fd o -1. */
+static int lb_lock_journal(void) {
+    int fd = open(LEADERBOARD_JNL, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    if (flock(fd, LOCK_EX) != 0) { close(fd); return -1; }
+    return fd;
+}
+
+static void lb_unlock_journal(int fd) {
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+/** @brief Une el snapshot actual con su journal en un snapshot nuevo (gen + 1)
+ *         y vacía el journal. Requiere el lock del journal.
+ */
+static bool lb_compact_locked(int jfd) {
+    size_t len = 0;
+    ino_t ino;
+    LbSnapHeader* h = lb_snap_map(&len, &ino);
+    uint32_t gen = h ? h->gen : 0;
+    uint64_t old_n = h ? h->count : 0;
+
+    LbRecord* tail = NULL;
+    long tail_n = lb_read_journal(jfd, gen, &tail);
+    if (tail_n < 0) tail_n = 0;
+    lb_sort_newest_first(tail, tail_n);
+
+    LbRecord* merged = (LbRecord*)malloc((old_n + tail_n + 1) * sizeof(LbRecord));
+    bool ok = merged != NULL;
+    if (ok) {
+        // Ante empate exacto gana el journal (más nuevo que todo el snapshot).
+        const LbRecord* old = h ? lb_snap_records(h) : NULL;
+        std::merge(tail, tail + tail_n, old, old + old_n, merged,
+                   [](const LbRecord& a, const LbRecord& b) { return cmp_record(&a, &b) < 0; });
+        ok = lb_write_snapshot(merged, old_n + tail_n, gen + 1) && ftruncate(jfd, 0) == 0;
+    }
+    free(merged);
+    free(tail);
+    if (h) munmap(h, len);
+    return ok;
+}
+
+/** @brief Reemplaza el leaderboard binario con las filas de un CSV. Requiere el lock.
+ *  @return filas importadas, o -1 si no se pudo leer el archivo.
+ */
+static long lb_import_csv_locked(int jfd, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    long cap = 1024, n = 0;
+    LbRecord* recs = (LbRecord*)malloc(cap * sizeof(LbRecord));
+    char line[128];
+    Entry e;
+    while (recs && fgets(line, sizeof(line), f)) {
+        if (!parse_entry_line(line, &e)) continue;
+        if (n == cap) {
+            cap *= 2;
+            LbRecord* grown = (LbRecord*)realloc(recs, cap * sizeof(LbRecord));
+            if (!grown) break;
+            recs = grown;
+        }
+        record_from_entry(&recs[n++], &e);
+    }
+    fclose(f);
+    if (!recs) return -1;
+
+    lb_sort_newest_first(recs, n);
+    LbSnapHeader h;
+    uint32_t gen = lb_snap_header(&h) ? h.gen + 1 : 1;
+    bool ok = lb_write_snapshot(recs, (uint64_t)n, gen) && ftruncate(jfd, 0) == 0;
+    free(recs);
+    return ok ? n : -1;
+}
+
+/** @brief Agrega un lote al journal (un write()) y compacta cada LB_COMPACT_EVERY registros.
+ *  @note Requiere el lock del journal y un snapshot existente.
+ */
+static bool lb_append_locked(int jfd, const Entry* es, int n, bool durable) {
+    LbSnapHeader h;
+    if (!lb_snap_header(&h)) return false;
+
+    // Un escritor que murió a mitad de registro deja una cola parcial: recortarla
+    // para que los registros siguientes queden alineados.
+    struct stat sb;
+    if (fstat(jfd, &sb) != 0) return false;
+    off_t whole = sb.st_size - sb.st_size % (off_t)sizeof(LbJournalRec);
+    if (whole != sb.st_size && ftruncate(jfd, whole) != 0) return false;
+
+    LbJournalRec batch[LB_QUEUE_CAP];
+    if (n > LB_QUEUE_CAP) n = LB_QUEUE_CAP;
+    for (int i = 0; i < n; ++i) {
+        memset(&batch[i], 0, sizeof(batch[i]));
+        record_from_entry(&batch[i].rec, &es[i]);
+        batch[i].gen = h.gen;
+        batch[i].crc = journal_crc(&batch[i]);
+    }
+    size_t bytes = (size_t)n * sizeof(LbJournalRec);
+    if (write(jfd, batch, bytes) != (ssize_t)bytes) return false;
+    if (durable) fsync(jfd);
+
+    long in_journal = (long)(whole / (off_t)sizeof(LbJournalRec)) + n;
+    if (in_journal >= LB_COMPACT_EVERY) lb_compact_locked(jfd);
+    return true;
+}
+
+// ===== Estadísticas por jugador (índice hash de nombres, incremental) =====
+// LEADERBOARD_PLAYERS: PlayerFileHeader + PlayerStat[slots], tabla hash con sondeo
+// lineal por nombre. append_entries la actualiza en su lugar (mmap) bajo el lock
+// del journal, así que nunca se re-escanea el historial; solo se reconstruye
+// desde el CSV si el archivo no existe. Al superar 50% de carga se rehace al
+// doble en un temporal + rename(). Como los registros cambian en su lugar, el header
+// lleva un contador de secuencia (seqlock entre procesos): el escritor lo deja impar
+// mientras modifica y par al terminar; los lectores copian la tabla sin locks y
+// reintentan si lo vieron impar o cambió durante la copia.
+
+#define PLAYERS_MAGIC     "PONGPL2"
+#define PLAYERS_MIN_SLOTS 256
+#define PLAYERS_READ_TRIES 64     // reintentos del lector antes de rendirse
+
+typedef struct {
+    char     name[32];        // "" = slot libre
+    uint32_t hash;
+    int32_t  wins, losses;
+    int32_t  streak;          // racha actual de victorias
+    int32_t  best_streak;     // racha más larga
+    int32_t  reserved;
+    int64_t  points_for, points_against;
+    int64_t  last_played;
+} PlayerStat;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t slots;           // potencia de 2
+    uint64_t players;
+    uint64_t matches;
+    uint64_t seq;             // impar = escritura en curso (solo con __atomic_*)
+} PlayerFileHeader;
+
+// Criterios de orden de la vista de jugadores.
+typedef enum {
+    PSORT_WINS = 0,
+    PSORT_WINRATE,
+    PSORT_DIFF,
+    PSORT_STREAK,
+    PSORT_COUNT
+} PlayerSort;
+
+static PlayerStat* player_slots(PlayerFileHeader* h) { return (PlayerStat*)(h + 1); }
+
+static size_t players_bytes(uint32_t slots) {
+    return sizeof(PlayerFileHeader) + (size_t)slots * sizeof(PlayerStat);
+}
+
+/** @brief FNV-1a de 32 bits sobre el nombre. */
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/** @brief Tabla vacía en memoria (malloc) con slots entradas. */
+static PlayerFileHeader* players_alloc(uint32_t slots) {
+    PlayerFileHeader* h = (PlayerFileHeader*)calloc(1, players_bytes(slots));
+    if (!h) return NULL;
+    memcpy(h->magic, PLAYERS_MAGIC, 8);
+    h->version = LB_VERSION;
+    h->slots = slots;
+    return h;
+}
+
+/** @brief Slot del nombre (existente o libre donde insertarlo). Hay al menos un libre. */
+static PlayerStat* players_slot(PlayerFileHeader* h, const char* name, uint32_t hash) {
+    PlayerStat* tab = player_slots(h);
+    uint32_t mask = h->slots - 1;
+    for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+        if (tab[i].name[0] == '\0') return &tab[i];
+        if (tab[i].hash == hash && strcmp(tab[i].name, name) == 0) return &tab[i];
+    }
+}
+
+/** @brief Copia la tabla a otra con new_slots entradas (rehash). */
+static PlayerFileHeader* players_rehash(PlayerFileHeader* old, uint32_t new_slots) {
+    PlayerFileHeader* h = players_alloc(new_slots);
+    if (!h) return NULL;
+    h->players = old->players;
+    h->matches = old->matches;
+    const PlayerStat* tab = player_slots(old);
+    for (uint32_t i = 0; i < old->slots; ++i) {
+        if (tab[i].name[0] != '\0') *players_slot(h, tab[i].name, tab[i].hash) = tab[i];
+    }
+    return h;
+}
+
+/** @brief Suma un resultado a un jugador (lo interna si es nuevo). */
+static void player_account(PlayerFileHeader* h, const char* name, bool won,
+                           int pf, int pa, int64_t ts) {
+    uint32_t hash = name_hash(name);
+    PlayerStat* p = players_slot(h, name, hash);
+    if (p->name[0] == '\0') {
+        snprintf(p->name, sizeof(p->name), "%s", name);
+        p->hash = hash;
+        h->players++;
+    }
+    if (won) {
+        p->wins++;
+        p->streak++;
+        if (p->streak > p->best_streak) p->best_streak = p->streak;
+    } else {
+        p->losses++;
+        p->streak = 0;
+    }
+    p->points_for     += pf;
+    p->points_against += pa;
+    if (ts > p->last_played) p->last_played = ts;
+}
+
+/** @brief true si agregar dos jugadores más dejaría la tabla sobre 50% de carga. */
+static bool players_need_grow(const PlayerFileHeader* h) {
+    return (h->players + 2) * 2 > h->slots;
+}
+
+/** @brief Aplica una partida a la tabla, creciendo si hace falta.
+ *  @return la tabla a usar desde ahora: la misma, o una nueva en memoria si creció
+ *          (en ese caso owned pasa a true y el llamador debe guardarla).
+ */
+static PlayerFileHeader* players_apply(PlayerFileHeader* h, bool* owned, const Entry* e) {
+    if (players_need_grow(h)) {
+        PlayerFileHeader* bigger = players_rehash(h, h->slots * 2);
+        if (!bigger) return h;
+        if (*owned) free(h);
+        h = bigger;
+        *owned = true;
+    }
+    player_account(h, e->winner, true,  e->winScore,  e->loseScore, (int64_t)e->ts);
+    player_account(h, e->loser,  false, e->loseScore, e->winScore,  (int64_t)e->ts);
+    h->matches++;
+    return h;
+}
+
+/** @brief Guarda una tabla en memoria como LEADERBOARD_PLAYERS (temporal + rename()). */
+static bool players_write_file(const PlayerFileHeader* h) {
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", LEADERBOARD_PLAYERS, (int)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t bytes = players_bytes(h->slots), off = 0;
+    bool ok = true;
+    while (ok && off < bytes) {
+        ssize_t w = write(fd, (const char*)h + off, bytes - off);
+        if (w <= 0) ok = false; else off += (size_t)w;
+    }
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp, LEADERBOARD_PLAYERS) != 0) {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+/** @brief Mapea LEADERBOARD_PLAYERS. @return NULL si no existe o es inválido. */
+static PlayerFileHeader* players_map(bool writable, size_t* len) {
+    int fd = open(LEADERBOARD_PLAYERS, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat sb;
+    PlayerFileHeader* h = NULL;
+    if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(PlayerFileHeader)) {
+        int prot = PROT_READ | (writable ? PROT_WRITE : 0);
+        void* p = mmap(NULL, (size_t)sb.st_size, prot, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            h = (PlayerFileHeader*)p;
+            *len = (size_t)sb.st_size;
+            if (memcmp(h->magic, PLAYERS_MAGIC, 8) != 0 || h->version != LB_VERSION ||
+                h->slots == 0 || (h->slots & (h->slots - 1)) != 0 ||
+                players_bytes(h->slots) > *len) {
+                munmap(p, *len);
+                h = NULL;
+            }
+        }
+    }
+    close(fd);
+    return h;
+}
+
+/** @brief Reemplaza LEADERBOARD_PLAYERS con las estadísticas de un CSV (en orden de
+ *         filas, que es el cronológico de las rachas). Requiere el lock.
+ */
+static bool players_rebuild_locked(const char* path) {
+    PlayerFileHeader* h = players_alloc(PLAYERS_MIN_SLOTS);
+    if (!h) return false;
+    bool owned = true;
+    FILE* f = fopen(path, "r");
+    if (f) {
+        char line[128];
+        Entry e;
+        while (fgets(line, sizeof(line), f)) {
+            if (parse_entry_line(line, &e)) h = players_apply(h, &owned, &e);
+        }
+        fclose(f);
+    }
+    bool ok = players_write_file(h);
+    free(h);
+    return ok;
+}
+
+/** @brief Crea LEADERBOARD_PLAYERS desde el CSV completo si no existe. Requiere el lock. */
+static void players_ensure_locked(void) {
+    size_t len;
+    PlayerFileHeader* m = players_map(false, &len);
+    if (m) { munmap(m, len); return; }
+    players_rebuild_locked(LEADERBOARD_FILE);
+}
+
+/** @brief Suma un lote de partidas a las estadísticas. Requiere el lock del journal.
+ *  @details Los cambios en su lugar van entre dos incrementos de m->seq. Un escritor que
+ *           murió a mitad deja seq impar: seq | 1 lo retoma sin invertir la paridad.
+ */
+static void players_update_locked(const Entry* es, int n, bool durable) {
+    size_t len;
+    PlayerFileHeader* m = players_map(true, &len);
+    if (!m) return;
+    const uint64_t seq = __atomic_load_n(&m->seq, __ATOMIC_RELAXED) | 1;
+    __atomic_store_n(&m->seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);   // seq impar visible antes que los cambios
+    PlayerFileHeader* h = m;
+    bool owned = false;
+    for (int i = 0; i < n; ++i) h = players_apply(h, &owned, &es[i]);
+    __atomic_store_n(&m->seq, seq + 1, __ATOMIC_RELEASE);
+    if (owned) {
+        players_write_file(h);   // creció: se publica entera con rename()
+        free(h);
+    } else if (durable) {
+        msync(m, len, MS_SYNC);
+    }
+    munmap(m, len);
+}
+
+/** @brief true si a va antes que b según el criterio elegido. */
+static bool player_before(const PlayerStat& a, const PlayerStat& b, PlayerSort key) {
+    long long ka = 0, kb = 0;
+    switch (key) {
+        case PSORT_WINS:    ka = a.wins; kb = b.wins; break;
+        case PSORT_WINRATE: {
+            // Compara wins/(wins+losses) en enteros: a.w * b.total vs b.w * a.total
+            long long ta = a.wins + a.losses, tb = b.wins + b.losses;
+            ka = (long long)a.wins * (tb ? tb : 1);
+            kb = (long long)b.wins * (ta ? ta : 1);
+            break;
+        }
+        case PSORT_DIFF:    ka = a.points_for - a.points_against;
+                            kb = b.points_for - b.points_against; break;
+        case PSORT_STREAK:  ka = a.best_streak; kb = b.best_streak; break;
+        default: break;
+    }
+    if (ka != kb) return ka > kb;
+    if (a.wins != b.wins) return a.wins > b.wins;
+    return a.last_played > b.last_played;
+}
+
+/** @brief Copia los jugadores de la tabla mapeada sin locks (lado lector del seqlock).
+ *  @return cuántos copió en *out (malloc), o -1 si no logró una copia consistente.
+ */
+static long players_copy(const PlayerFileHeader* h, PlayerStat** out) {
+    const PlayerStat* tab = (const PlayerStat*)(h + 1);
+    PlayerStat* all = (PlayerStat*)malloc((size_t)h->slots * sizeof(PlayerStat));
+    if (!all) return -1;
+    for (int attempt = 0; attempt < PLAYERS_READ_TRIES; ++attempt) {
+        const uint64_t s0 = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+        if (s0 & 1) { usleep(1000); continue; }
+        long m = 0;
+        for (uint32_t i = 0; i < h->slots; ++i) {
+            if (tab[i].name[0] != '\0') all[m++] = tab[i];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);   // la copia antes de releer seq
+        if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) == s0) {
+            *out = all;
+            return m;
+        }
+    }
+    free(all);
+    return -1;
+}
+
+/** @brief Los k mejores jugadores según key (partial_sort O(P log k)).
+ *  @details Lector sin locks como lb_view_open: nunca bloquea a append_entries. La
+ *           tabla se copia con players_copy y el orden se hace sobre la copia.
+ *  @return cuántos copió en out, o -1 si no hay estadísticas.
+ */
+static int players_top(PlayerStat* out, int k, PlayerSort key) {
+    size_t len;
+    PlayerFileHeader* h = players_map(false, &len);
+    if (!h) return -1;
+    PlayerStat* all = NULL;
+    const long m = players_copy(h, &all);
+    munmap(h, len);
+    if (m < 0) return -1;
+
+    int n = (m < k) ? (int)m : k;
+    std::partial_sort(all, all + n, all + m, [key](const PlayerStat& a, const PlayerStat& b) {
+        return player_before(a, b, key);
+    });
+    memcpy(out, all, (size_t)n * sizeof(PlayerStat));
+    free(all);
+    return n;
+}
+
+/** @brief Crea snapshot y estadísticas iniciales desde LEADERBOARD_FILE si todavía no existen. */
+static bool lb_bootstrap(void) {
+    LbSnapHeader h;
+    size_t plen;
+    PlayerFileHeader* pm = players_map(false, &plen);
+    if (pm) munmap(pm, plen);
+    if (pm && lb_snap_header(&h)) return true;
+    int jfd = lb_lock_journal();
+    if (jfd < 0) return false;
+    bool ok = lb_snap_header(&h);   // otro proceso pudo crearlo mientras esperábamos
+    if (!ok) {
+        ok = lb_import_csv_locked(jfd, LEADERBOARD_FILE) >= 0 ||
+             lb_write_snapshot(NULL, 0, 1);
+    }
+    players_ensure_locked();
+    lb_unlock_journal(jfd);
+    return ok;
+}
+
+static void lb_view_close(LbView* v) {
+    if (v->snap) munmap(v->snap, v->snap_len);
+    free(v->tail);
+    v->snap = NULL;
+    v->tail = NULL;
+    v->tail_n = 0;
+}
+
+/** @brief Abre una vista consistente sin tomar locks.
+ *  @details Si una compactación reemplazó el snapshot mientras se leía el journal
+ *           (cambia el inode), se reintenta con el snapshot nuevo.
+ */
+static bool lb_view_open(LbView* v) {
+    memset(v, 0, sizeof(*v));
+    if (!lb_bootstrap()) return false;
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        ino_t ino;
+        v->snap = lb_snap_map(&v->snap_len, &ino);
+        if (!v->snap) return false;
+
+        int jfd = open(LEADERBOARD_JNL, O_RDONLY | O_CREAT, 0644);
+        v->tail_n = (jfd >= 0) ? lb_read_journal(jfd, v->snap->gen, &v->tail) : 0;
+        if (jfd >= 0) close(jfd);
+        if (v->tail_n < 0) v->tail_n = 0;
+
+        struct stat sb;
+        if (stat(LEADERBOARD_SNAP, &sb) == 0 && sb.st_ino == ino) {
+            lb_sort_newest_first(v->tail, v->tail_n);
+            return true;
+        }
+        lb_view_close(v);
+    }
+    return false;
+}
+
+/** @brief Top k de la vista: mezcla los primeros k del snapshot con la cola del journal. */
+static int lb_view_top(const LbView* v, Entry* out, int k) {
+    const LbRecord* old = lb_snap_records(v->snap);
+    uint64_t i = 0, n_old = v->snap->count;
+    long j = 0;
+    int n = 0;
+    while (n < k && (i < n_old || j < v->tail_n)) {
+        bool take_tail = j < v->tail_n && (i >= n_old || cmp_record(&v->tail[j], &old[i]) <= 0);
+        entry_from_record(&out[n++], take_tail ? &v->tail[j++] : &old[i++]);
+    }
+    return n;
+}
+
+/** @brief Agrega un lote al leaderboard: historial CSV + journal binario.
+ *  @details Todo bajo el lock del journal, así un bootstrap concurrente no
+ *           importa del CSV filas que también van a entrar por el journal.
+ *  @param durable true: fsync de CSV y journal antes de volver.
+ */
+static void append_entries(const Entry* es, int n, bool durable) {
+    int jfd = lb_lock_journal();
+    if (jfd < 0) {
+        append_entries_csv(es, n, durable);
+        return;
+    }
+    LbSnapHeader h;
+    if (!lb_snap_header(&h) && lb_import_csv_locked(jfd, LEADERBOARD_FILE) < 0) {
+        lb_write_snapshot(NULL, 0, 1);
+    }
+    players_ensure_locked();
+    append_entries_csv(es, n, durable);
+    lb_append_locked(jfd, es, n, durable);
+    players_update_locked(es, n, durable);
+    lb_unlock_journal(jfd);
+}
+
+/** @brief Agrega una entrada al leaderboard de forma síncrona. */
+static void append_entry(const Entry* e) {
+    append_entries(e, 1, false);
+}
+
+// ===== Escritor asíncrono del leaderboard =====
+// play_screen encola el Entry y sigue; th_lb_writer junta lo que haya en la cola
+// y lo escribe en lote (un fopen, un lb_open, fsync/msync) fuera del hilo de UI.
+
+static Entry           g_lbq[LB_QUEUE_CAP];
+static int             g_lbq_head = 0, g_lbq_count = 0;
+static int             g_lbq_inflight = 0;      // lote tomado por el escritor y aún no escrito
+static bool            g_lbq_running = false;
+static bool            g_lbq_stop = false;
+static pthread_mutex_t g_lbq_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_lbq_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  g_lbq_not_full  = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  g_lbq_idle      = PTHREAD_COND_INITIALIZER;
+static pthread_t       th_lb_writer;
+
+/** @brief Hilo escritor: vacía la cola en lotes hasta que se pida parar y quede vacía. */
+static void* thread_lb_writer_func(void* arg) {
+    (void)arg;
+    const int64_t cpu0 = thread_cpu_ns();
+    Entry batch[LB_QUEUE_CAP];
+    pthread_mutex_lock(&g_lbq_lock);
+    while (1) {
+        while (g_lbq_count == 0 && !g_lbq_stop) pthread_cond_wait(&g_lbq_not_empty, &g_lbq_lock);
+        if (g_lbq_count == 0 && g_lbq_stop) break;
+
+        int n = g_lbq_count;
+        for (int i = 0; i < n; ++i) batch[i] = g_lbq[(g_lbq_head + i) % LB_QUEUE_CAP];
+        g_lbq_head = (g_lbq_head + n) % LB_QUEUE_CAP;
+        g_lbq_count = 0;
+        g_lbq_inflight = n;
+        pthread_cond_broadcast(&g_lbq_not_full);
+        pthread_mutex_unlock(&g_lbq_lock);
+
+        const int64_t t_app = mono_ns();
+        append_entries(batch, n, true);
+        trace_span(&g_tr_lb, "append_entries", t_app, mono_ns());
+
+        pthread_mutex_lock(&g_lbq_lock);
+        g_lbq_inflight = 0;
+        pthread_cond_broadcast(&g_lbq_idle);
+    }
+    pthread_mutex_unlock(&g_lbq_lock);
+    g_ts_lb.cpu_ns += thread_cpu_ns() - cpu0;
+    return NULL;
+}
+
+/** @brief Lanza el hilo escritor. Si falla, lb_writer_submit escribe en línea. */
+static void lb_writer_start(void) {
+    g_lbq_stop = false;
+    g_lbq_running = pthread_create(&th_lb_writer, NULL, thread_lb_writer_func, NULL) == 0;
+}
+
+/** @brief Encola una entrada; solo bloquea si la cola está llena. */
+static void lb_writer_submit(const Entry* e) {
+    if (!g_lbq_running) { append_entry(e); return; }
+    pthread_mutex_lock(&g_lbq_lock);
+    while (g_lbq_count == LB_QUEUE_CAP) pthread_cond_wait(&g_lbq_not_full, &g_lbq_lock);
+    g_lbq[(g_lbq_head + g_lbq_count) % LB_QUEUE_CAP] = *e;
+    g_lbq_count++;
+    pthread_cond_signal(&g_lbq_not_empty);
+    pthread_mutex_unlock(&g_lbq_lock);
+}
+
+/** @brief Espera a que todo lo encolado esté escrito (p.ej. antes de leer el Top). */
+static void lb_writer_flush(void) {
+    if (!g_lbq_running) return;
+    pthread_mutex_lock(&g_lbq_lock);
+    while (g_lbq_count > 0 || g_lbq_inflight > 0) pthread_cond_wait(&g_lbq_idle, &g_lbq_lock);
+    pthread_mutex_unlock(&g_lbq_lock);
+}
+
+/** @brief Pide al escritor que termine, espera a que vacíe la cola y lo une. */
+static void lb_writer_stop(void) {
+    if (!g_lbq_running) return;
+    pthread_mutex_lock(&g_lbq_lock);
+    g_lbq_stop = true;
+    pthread_cond_signal(&g_lbq_not_empty);
+    pthread_mutex_unlock(&g_lbq_lock);
+    pthread_join(th_lb_writer, NULL);
+    g_lbq_running = false;
+}
+
+/** @brief Lee una línea de texto (bloqueante) con edición básica en ncurses.
+ *  @param out buffer destino (maxlen + '\0')
+ *  @note Muestra y posiciona cursor temporalmente.
+ */
+static void read_line_ncurses(char* out, int maxlen, int y, int x) {
+    int len = 0;
+    out[0] = '\0';
+    move(y, x);
+    curs_set(1);
+    while (1) {
+        int ch = getch();
+        if (ch == '\n' || ch == KEY_ENTER) break;
+        else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+            if (len > 0) {
+                len--;
+                out[len] = '\0';
+                mvaddch(y, x+len, ' ');
+                move(y, x+len);
+            }
+        } else if (ch >= 32 && ch <= 126) {
+            if (len < maxlen) {
+                out[len++] = (char)ch;
+                out[len] = '\0';
+                mvaddch(y, x+len-1, ch);
+            }
+        }
+        refresh();
+    }
+    curs_set(0);
+    if (len == 0) strncpy(out, "Jugador", maxlen);
+}
+
+/** @brief Fila en la que la bola llegará a la columna face_x, con rebotes en techo y piso.
+ *  @details Prolonga la recta sin paredes y la pliega en forma cerrada sobre
+ *           [top+1, bottom-1] (reflexión = onda triangular de período 2L).
+ */
+static num_t cpu_predict_arrival_y(const Match* m, num_t face_x) {
+    const Ball* b = &m->ball;
+    const num_t lo = m->top + 1;
+    const num_t span = (m->bottom - 1) - (m->top + 1);
+    if (span <= 0 || b->vx == 0) return lo;
+
+    num_t t = (face_x - b->x) / b->vx;
+    if (t < 0) t = 0;
+    num_t u = num_mod(b->y + b->vy * t - lo, span * 2);
+    return lo + (u <= span ? u : span * 2 - u);
+}
+
+/** @brief Fila de llegada prolongando la recta sin rebotes, recortada a [top+1, bottom-1]. */
+static num_t cpu_linear_arrival_y(const Match* m, num_t face_x) {
+    const Ball* b = &m->ball;
+    if (b->vx == 0) return b->y;
+    num_t t = (face_x - b->x) / b->vx;
+    if (t < 0) t = 0;
+    num_t y = b->y + b->vy * t;
+    if (y < num_t(m->top + 1))    y = m->top + 1;
+    if (y > num_t(m->bottom - 1)) y = m->bottom - 1;
+    return y;
+}
+
+/** @brief IA: decide dirección de movimiento (-1,0,+1) para una paleta CPU.
+ *  @details Si la bola viene hacia la paleta, va hacia la fila que elige la estrategia
+ *           de su CpuConfig. El plan (error aleatorio y, si predice, la fila de llegada)
+ *           se calcula una vez por trayectoria (traj_gen) y se reutiliza hasta el
+ *           próximo golpe o saque. Si la bola se aleja, vuelve hacia el centro.
+ */
+static int cpu_calculate_direction(Match* m, int player) {
+    const Paddle* cpu_paddle = (player == 1) ? &m->pad1 : &m->pad2;
+    CpuState*     cpu        = (player == 1) ? &m->cpu1 : &m->cpu2;
+    const CpuConfig* cfg     = cpu->cfg;
+
+    // Solo reaccionar si la pelota viene hacia la CPU
+    bool ball_coming = (cpu_paddle->x > m->midX && m->ball.vx > 0) || 
+                       (cpu_paddle->x < m->midX && m->ball.vx < 0);
+    
+    if (!ball_coming) {
+        // Volver al centro cuando la pelota no viene hacia nosotros
+        num_t center = num_t(m->top + m->bottom) / 2;
+        if (cpu_paddle->y < center - 1) return 1;
+        if (cpu_paddle->y > center + 1) return -1;
+        return 0;
+    }
+
+    if (cpu->plan_gen != m->traj_gen) {
+        // Agregar margen de error aleatorio para hacer la CPU más humana
+        cpu->aim_err = 0;
+        if (rng_below(&cpu->rng, 100) < (uint32_t)cfg->error_pct) {
+            cpu->aim_err = num_t(cfg->error_margin) * (rng_below(&cpu->rng, 2) ? 1 : -1);
+        }
+        num_t face_x = (player == 1) ? cpu_paddle->x + 1 : cpu_paddle->x - 1;
+        if (cfg->strategy == CPU_STRAT_PREDICT) {
+            cpu->target_y = cpu_predict_arrival_y(m, face_x) + cpu->aim_err;
+        } else if (cfg->strategy == CPU_STRAT_LINEAR) {
+            cpu->target_y = cpu_linear_arrival_y(m, face_x) + cpu->aim_err;
+        }
+        cpu->plan_gen = m->traj_gen;
+    }
+    num_t target = (cfg->strategy == CPU_STRAT_TRACK) ? m->ball.y + cpu->aim_err : cpu->target_y;
+    
+    // Decidir dirección
+    num_t diff = target - cpu_paddle->y;
+    if (diff < num_t(-0.5f)) return -1;
+    if (diff > num_t(0.5f)) return 1;
+    return 0;
+}
+
+/** @brief IA con retardo de reacción: solo decide cada reaction_delay ticks de su CpuConfig.
+ *  @param player 1 (paleta izquierda) o 2 (paleta derecha).
+ */
+static int match_cpu_dir(Match* m, int player) {
+    CpuState* cpu = (player == 1) ? &m->cpu1 : &m->cpu2;
+    int* counter = &cpu->delay_counter;
+    (*counter)++;
+    if (*counter < cpu->cfg->reaction_delay) return 0;
+    *counter = 0;
+    return cpu_calculate_direction(m, player);
+}
+
+/** @brief true si la fila y (posición de la bola) cae en las celdas de una paleta. */
+static bool paddle_hits_row(const Paddle* p, num_t y) {
+    int yp = (int)p->y;
+    int yy = (int)y;
+    return yy >= yp - PADDLE_LEN/2 && yy <= yp + PADDLE_LEN/2;
+}
+
+/** @brief Integra la bola un tick con colisión continua (barrido), rebotes y puntaje.
+ *  @details La bola recorre el segmento x + vx, y + vy del tick. En cada iteración se
+ *           busca el primer contacto (techo/piso o cara de una paleta), se avanza hasta
+ *           ahí, se refleja y se sigue con el tiempo restante, así ningún contacto se
+ *           salta aunque la velocidad supere una celda por tick. Caras de contacto:
+ *           pad1.x + 1 (bola llegando por la derecha) y pad2.x - 1 (borde izquierdo de
+ *           la bola tocando la paleta derecha). Los goles se miden al final del tick.
+ */
+static void match_ball_step(Match* m) {
+    Ball* b = &m->ball;
+    const num_t wall_top = m->top + 1;
+    const num_t wall_bot = m->bottom - 1;
+    const num_t face1 = m->pad1.x + 1;
+    const num_t face2 = m->pad2.x - 1;
+
+    num_t t_left = 1;
+    for (int contact = 0; contact < BALL_MAX_CONTACTS && t_left > 0; ++contact) {
+        enum { HIT_NONE, HIT_WALL, HIT_PAD1, HIT_PAD2 } hit = HIT_NONE;
+        num_t t_hit = t_left;
+
+        // --- Techo y piso ---
+        if (b->vy < 0) {
+            num_t t = (wall_top - b->y) / b->vy;
+            if (t < t_hit) { t_hit = t < 0 ? num_t(0) : t; hit = HIT_WALL; }
+        } else if (b->vy > 0) {
+            num_t t = (wall_bot - b->y) / b->vy;
+            if (t < t_hit) { t_hit = t < 0 ? num_t(0) : t; hit = HIT_WALL; }
+        }
+
+        // --- Cara de la paleta izquierda (solo si la bola viene hacia la izquierda) ---
+        if (b->vx < 0 && b->x >= face1) {
+            num_t t = (face1 - b->x) / b->vx;
+            if (t <= t_hit && paddle_hits_row(&m->pad1, b->y + b->vy * t)) { t_hit = t; hit = HIT_PAD1; }
+        }
+        // --- Cara de la paleta derecha (solo si la bola viene hacia la derecha) ---
+        if (b->vx > 0 && b->x <= face2) {
+            num_t t = (face2 - b->x) / b->vx;
+            if (t <= t_hit && paddle_hits_row(&m->pad2, b->y + b->vy * t)) { t_hit = t; hit = HIT_PAD2; }
+        }
+
+        b->x += b->vx * t_hit;
+        b->y += b->vy * t_hit;
+        t_left -= t_hit;
+
+        if (hit == HIT_NONE) break;
+        if (hit == HIT_WALL) {
+            b->y = (b->vy < 0) ? wall_top : wall_bot;
+            b->vy = -b->vy;
+        } else {
+            const Paddle* p = (hit == HIT_PAD1) ? &m->pad1 : &m->pad2;
+            b->x = (hit == HIT_PAD1) ? face1 : face2;
+            b->vx = -b->vx;
+            int dy = (int)b->y - (int)p->y;
+            b->vy += num_t(0.15f) * dy;
+            m->traj_gen++;
+        }
+    }
+    // Más contactos que BALL_MAX_CONTACTS en un tick: la bola queda dentro del campo.
+    if (b->y < wall_top) b->y = wall_top;
+    if (b->y > wall_bot) b->y = wall_bot;
+
+    // --- Detección de gol: reinicia bola y suma puntaje ---
+    if ((int)b->x <= m->left) {
+        m->score.p2++;
+        ball_spawn_random(m, true);   // sirve hacia la derecha
+    } else if ((int)b->x >= m->right) {
+        m->score.p1++;
+        ball_spawn_random(m, false);  // sirve hacia la izquierda
+    }
+}
+
+/** @brief Integra movimiento suave de paleta con aceleración, fricción y clamping.
+ *  @param input_dir -1 arriba, 0 neutro, +1 abajo.
+ */
+static void move_paddle(const Match* m, Paddle* p, int input_dir) {
+    p->vy += num_t(PADDLE_ACC * PADDLE_DT) * input_dir;
+
+    // Acelera según input; aplica fricción cuando no hay input.
+    if (input_dir == 0) {
+        if (p->vy > 0) {
+            p->vy -= num_t(PADDLE_FRICTION * PADDLE_DT);
+            if (p->vy < 0) p->vy = 0;
+        } else if (p->vy < 0) {
+            p->vy += num_t(PADDLE_FRICTION * PADDLE_DT);
+            if (p->vy > 0) p->vy = 0;
+        }
+    }
+
+    // Limita velocidad máxima para evitar “teletransportes”.
+    if (p->vy > num_t(PADDLE_MAX_V))  p->vy = num_t(PADDLE_MAX_V);
+    if (p->vy < -num_t(PADDLE_MAX_V)) p->vy = -num_t(PADDLE_MAX_V);
+
+    p->y += p->vy * num_t(PADDLE_DT);
+
+    // Integra posición y recorta contra límites del campo.
+    num_t minY = m->top + 1 + PADDLE_LEN/2;
+    num_t maxY = m->bottom - 1 - PADDLE_LEN/2;
+    if (p->y < minY) { p->y = minY; p->vy = 0; }
+    if (p->y > maxY) { p->y = maxY; p->vy = 0; }
+}
+
+/** @brief Avanza la partida un tick completo: paleta 1, paleta 2 y bola.
+ *  @param dir1,dir2 dirección de cada paleta (-1,0,+1), ya resuelta por input o IA.
+ */
+static void match_step(Match* m, int dir1, int dir2) {
+    move_paddle(m, &m->pad1, dir1);
+    move_paddle(m, &m->pad2, dir2);
+    match_ball_step(m);
+    m->ticks++;
+}
+
+// ===== Repeticiones (grabación de entradas y reproducción) =====
+// Archivo: ReplayHeader | entradas RLE | ReplayKeyframe[] | ReplayFooter.
+// Cada byte de entradas es (largo-1) << 4 | código, con código = (dir1+1)*3 + (dir2+1)
+// y rachas de hasta 16 ticks. La física es determinista dada la semilla, así que
+// semilla + entradas reproducen la partida; la IA no se reejecuta (sus decisiones
+// ya están en las entradas). Los keyframes guardan el estado físico cada
+// REPLAY_KEYFRAME_EVERY ticks para buscar sin simular desde el tick 0.
+
+#define REPLAY_MAGIC      "PONGRP1"
+#define REPLAY_END_MAGIC  "PONGRPE"
+#define REPLAY_VERSION    1
+#define REPLAY_FIXED_POINT 1u      // flags: grabado con -DPONG_FIXED_POINT
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t keyframe_size;        // sizeof(ReplayKeyframe) del build que grabó
+    int32_t  lines, cols;          // tamaño del campo (argumentos de match_init)
+    uint32_t mode;                 // GameMode
+    uint64_t seed;
+    char     name1[NAME_MAXLEN+1];
+    char     name2[NAME_MAXLEN+1];
+} ReplayHeader;
+
+// Estado físico tras 'tick' ticks; las entradas desde input_off reproducen el tick + 1.
+typedef struct {
+    int64_t  tick;
+    uint64_t input_off;
+    Ball     ball;
+    Paddle   pad1, pad2;
+    Score    score;
+    Rng      rng;
+} ReplayKeyframe;
+
+typedef struct {
+    uint64_t input_bytes;
+    uint64_t n_keyframes;
+    int64_t  ticks;                // ticks grabados
+    Score    final_score;
+    uint32_t crc;                  // CRC32 de header + entradas + keyframes
+    char     magic[8];
+} ReplayFooter;
+
+typedef struct {
+    bool            active;
+    ReplayHeader    hdr;
+    uint8_t*        inputs;
+    size_t          n_inputs, cap_inputs;
+    ReplayKeyframe* keys;
+    size_t          n_keys, cap_keys;
+    int             run_code, run_len;   // racha abierta (run_len 0 = ninguna)
+    int64_t         ticks;
+    Score           score;
+} ReplayRec;
+
+static ReplayRec   g_rec;
+static const char* g_record_path = NULL;   // --record: NULL = no grabar
+static int         g_record_count = 0;     // partidas grabadas en la sesión
+
+/** @brief Agrega un elemento a un arreglo dinámico (malloc/realloc, crecimiento x2). */
+static bool replay_push(void** arr, size_t* n, size_t* cap, const void* item, size_t size) {
+    if (*n == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 256;
+        void* p = realloc(*arr, ncap * size);
+        if (!p) return false;
+        *arr = p;
+        *cap = ncap;
+    }
+    memcpy((char*)*arr + *n * size, item, size);
+    (*n)++;
+    return true;
+}
+
+/** @brief Cierra la racha de entradas abierta (si la hay) en bytes RLE. */
+static void replay_rec_flush_run(ReplayRec* r) {
+    if (r->run_len == 0) return;
+    uint8_t b = (uint8_t)(((r->run_len - 1) << 4) | r->run_code);
+    replay_push((void**)&r->inputs, &r->n_inputs, &r->cap_inputs, &b, 1);
+    r->run_len = 0;
+}
+
+/** @brief Copia el estado físico de m en un keyframe. */
+static void replay_keyframe_from_match(ReplayKeyframe* k, const Match* m, uint64_t input_off) {
+    memset(k, 0, sizeof(*k));
+    k->tick      = m->ticks;
+    k->input_off = input_off;
+    k->ball      = m->ball;
+    k->pad1      = m->pad1;
+    k->pad2      = m->pad2;
+    k->score     = m->score;
+    k->rng       = m->rng;
+}
+
+/** @brief Empieza a grabar la partida recién iniciada en m (campo de H x W). */
+static void replay_rec_begin(ReplayRec* r, const Match* m, int H, int W) {
+    r->active = true;
+    r->n_inputs = r->n_keys = 0;
+    r->run_len = 0;
+    r->ticks = 0;
+    r->score = m->score;
+    memset(&r->hdr, 0, sizeof(r->hdr));
+    memcpy(r->hdr.magic, REPLAY_MAGIC, sizeof(r->hdr.magic));
+    r->hdr.version = REPLAY_VERSION;
+#ifdef PONG_FIXED_POINT
+    r->hdr.flags = REPLAY_FIXED_POINT;
+#endif
+    r->hdr.keyframe_size = sizeof(ReplayKeyframe);
+    r->hdr.lines = H;
+    r->hdr.cols  = W;
+    r->hdr.mode  = (uint32_t)g_game_mode;
+    r->hdr.seed  = m->seed;
+    snprintf(r->hdr.name1, sizeof(r->hdr.name1), "%s", g_name1);
+    snprintf(r->hdr.name2, sizeof(r->hdr.name2), "%s", g_name2);
+}
+
+/** @brief Registra las direcciones de un tick ya aplicado a m (y un keyframe si toca).
+ *  @note Lo llama th_sim con g_lock tomado.
+ */
+static void replay_rec_tick(ReplayRec* r, const Match* m, int dir1, int dir2) {
+    if (!r->active) return;
+    int code = (dir1 + 1) * 3 + (dir2 + 1);
+    if (r->run_len > 0 && (r->run_code != code || r->run_len == 16)) replay_rec_flush_run(r);
+    r->run_code = code;
+    r->run_len++;
+    r->ticks = m->ticks;
+    r->score = m->score;
+
+    if (m->ticks % REPLAY_KEYFRAME_EVERY == 0) {
+        replay_rec_flush_run(r);   // el keyframe arranca en un byte de racha nuevo
+        ReplayKeyframe k;
+        replay_keyframe_from_match(&k, m, r->n_inputs);
+        replay_push((void**)&r->keys, &r->n_keys, &r->cap_keys, &k, sizeof(k));
+    }
+}
+
+/** @brief Termina la grabación y la escribe en path (si grabó al menos un tick). */
+static bool replay_rec_finish(ReplayRec* r, const char* path) {
+    if (!r->active) return false;
+    r->active = false;
+    if (r->ticks == 0) return false;
+    replay_rec_flush_run(r);
+
+    ReplayFooter f;
+    memset(&f, 0, sizeof(f));
+    f.input_bytes = r->n_inputs;
+    f.n_keyframes = r->n_keys;
+    f.ticks       = r->ticks;
+    f.final_score = r->score;
+    f.crc = crc32_update(0, &r->hdr, sizeof(r->hdr));
+    f.crc = crc32_update(f.crc, r->inputs, r->n_inputs);
+    f.crc = crc32_update(f.crc, r->keys, r->n_keys * sizeof(ReplayKeyframe));
+    memcpy(f.magic, REPLAY_END_MAGIC, sizeof(f.magic));
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(&r->hdr, sizeof(r->hdr), 1, fp) == 1
+           && fwrite(r->inputs, 1, r->n_inputs, fp) == r->n_inputs
+           && fwrite(r->keys, sizeof(ReplayKeyframe), r->n_keys, fp) == r->n_keys
+           && fwrite(&f, sizeof(f), 1, fp) == 1;
+    return fclose(fp) == 0 && ok;
+}
+
+/** @brief Cierra la grabación en curso con el nombre de la sesión: F, F.2, F.3, ... */
+static void replay_rec_save(void) {
+    if (!g_record_path || !g_rec.active) return;
+    char path[512];
+    if (g_record_count == 0) snprintf(path, sizeof(path), "%s", g_record_path);
+    else snprintf(path, sizeof(path), "%s.%d", g_record_path, g_record_count + 1);
+    if (replay_rec_finish(&g_rec, path)) g_record_count++;
+}
+
+/** @brief Empieza a grabar g_match si se pidió --record. */
+static void replay_rec_start(void) {
+    if (!g_record_path) return;
+    int H, W;
+    getmaxyx(stdscr, H, W);
+    replay_rec_begin(&g_rec, &g_match, H, W);
+}
+
+// Repetición cargada en memoria. Header, footer y keyframes se copian a memoria propia
+// (en el archivo los keyframes siguen a las entradas RLE y no quedan alineados).
+typedef struct {
+    uint8_t*        data;     // el archivo completo
+    size_t          size;
+    ReplayHeader    hdr;
+    ReplayFooter    foot;
+    const uint8_t*  inputs;   // apunta dentro de data
+    ReplayKeyframe* keys;     // foot.n_keyframes elementos
+} ReplayFile;
+
+// Posición de lectura en el flujo de entradas.
+typedef struct {
+    size_t off;
+    int    code, left;   // racha en curso
+} ReplayCursor;
+
+/** @brief Libera una repetición cargada. */
+static void replay_close(ReplayFile* rf) {
+    free(rf->data);
+    free(rf->keys);
+    memset(rf, 0, sizeof(*rf));
+}
+
+/** @brief Valida los keyframes: ticks crecientes dentro de la partida y offsets de
+ *         entrada crecientes dentro del flujo RLE (replay_seek confía en ambos).
+ */
+static bool replay_keys_valid(const ReplayFile* rf) {
+    int64_t  prev_tick = 0;
+    uint64_t prev_off  = 0;
+    for (uint64_t i = 0; i < rf->foot.n_keyframes; ++i) {
+        const ReplayKeyframe* k = &rf->keys[i];
+        if (k->tick <= prev_tick || k->tick > rf->foot.ticks) return false;
+        if (k->input_off < prev_off || k->input_off > rf->foot.input_bytes) return false;
+        prev_tick = k->tick;
+        prev_off  = k->input_off;
+    }
+    return true;
+}
+
+/** @brief Carga y valida (magic, versión, tamaños, CRC, keyframes, tipo numérico) un archivo de repetición. */
+static bool replay_open(ReplayFile* rf, const char* path, const char** err) {
+    memset(rf, 0, sizeof(*rf));
+    *err = "no se pudo leer el archivo";
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ReplayHeader) + sizeof(ReplayFooter)) {
+        close(fd);
+        *err = "archivo truncado";
+        return false;
+    }
+    rf->size = (size_t)st.st_size;
+    rf->data = (uint8_t*)malloc(rf->size);
+    bool read_ok = rf->data && read(fd, rf->data, rf->size) == (ssize_t)rf->size;
+    close(fd);
+    if (!read_ok) { replay_close(rf); return false; }
+
+    memcpy(&rf->hdr, rf->data, sizeof(ReplayHeader));
+    memcpy(&rf->foot, rf->data + rf->size - sizeof(ReplayFooter), sizeof(ReplayFooter));
+    rf->hdr.name1[NAME_MAXLEN] = '\0';
+    rf->hdr.name2[NAME_MAXLEN] = '\0';
+
+    // Los tamaños del footer no son confiables: se comparan contra lo que queda del
+    // archivo sin multiplicar ni sumar valores leídos (nada puede desbordar).
+    const size_t body = rf->size - sizeof(ReplayHeader) - sizeof(ReplayFooter);
+    *err = "formato no reconocido";
+    if (memcmp(rf->hdr.magic, REPLAY_MAGIC, sizeof(rf->hdr.magic)) != 0 ||
+        memcmp(rf->foot.magic, REPLAY_END_MAGIC, sizeof(rf->foot.magic)) != 0 ||
+        rf->hdr.version != REPLAY_VERSION || rf->hdr.keyframe_size != sizeof(ReplayKeyframe) ||
+        rf->foot.input_bytes > body ||
+        (body - rf->foot.input_bytes) % sizeof(ReplayKeyframe) != 0 ||
+        rf->foot.n_keyframes != (body - rf->foot.input_bytes) / sizeof(ReplayKeyframe)) {
+        replay_close(rf);
+        return false;
+    }
+    uint32_t crc = crc32_update(0, rf->data, rf->size - sizeof(ReplayFooter));
+    if (crc != rf->foot.crc) { *err = "CRC inválido"; replay_close(rf); return false; }
+#ifdef PONG_FIXED_POINT
+    const uint32_t flags = REPLAY_FIXED_POINT;
+#else
+    const uint32_t flags = 0;
+#endif
+    if ((rf->hdr.flags & REPLAY_FIXED_POINT) != flags) {
+        *err = "grabado con otro tipo numérico (PONG_FIXED_POINT)";
+        replay_close(rf);
+        return false;
+    }
+
+    rf->inputs = rf->data + sizeof(ReplayHeader);
+    const size_t keys_bytes = body - rf->foot.input_bytes;
+    if (keys_bytes > 0) {
+        rf->keys = (ReplayKeyframe*)malloc(keys_bytes);
+        if (!rf->keys) { *err = "sin memoria"; replay_close(rf); return false; }
+        memcpy(rf->keys, rf->inputs + rf->foot.input_bytes, keys_bytes);
+    }
+    if (rf->foot.ticks < 0 || !replay_keys_valid(rf)) {
+        *err = "keyframes inválidos";
+        replay_close(rf);
+        return false;
+    }
+    return true;
+}
+
+/** @brief Siguiente par de direcciones; false al final de las entradas. */
+static bool replay_next_input(const ReplayFile* rf, ReplayCursor* c, int* dir1, int* dir2) {
+    if (c->left == 0) {
+        if (c->off >= rf->foot.input_bytes) return false;
+        uint8_t b = rf->inputs[c->off++];
+        c->code = b & 0x0F;
+        c->left = (b >> 4) + 1;
+    }
+    c->left--;
+    *dir1 = c->code / 3 - 1;
+    *dir2 = c->code % 3 - 1;
+    return true;
+}
+
+/** @brief Deja m en el estado tras 'tick' ticks (acotado al largo de la repetición).
+ *  @details Restaura el último keyframe <= tick (o el inicio) y simula el resto.
+ */
+static void replay_seek(const ReplayFile* rf, Match* m, ReplayCursor* c, int64_t tick) {
+    if (tick < 0) tick = 0;
+    if (tick > rf->foot.ticks) tick = rf->foot.ticks;
+
+    match_init(m, rf->hdr.lines, rf->hdr.cols, rf->hdr.seed);
+    memset(c, 0, sizeof(*c));
+    long lo = 0, hi = (long)rf->foot.n_keyframes - 1, best = -1;
+    while (lo <= hi) {
+        long mid = (lo + hi) / 2;
+        if (rf->keys[mid].tick <= tick) { best = mid; lo = mid + 1; }
+        else hi = mid - 1;
+    }
+    if (best >= 0) {
+        const ReplayKeyframe* k = &rf->keys[best];
+        m->ball  = k->ball;
+        m->pad1  = k->pad1;
+        m->pad2  = k->pad2;
+        m->score = k->score;
+        m->rng   = k->rng;
+        m->ticks = k->tick;
+        c->off   = k->input_off;
+    }
+    int d1, d2;
+    while (m->ticks < tick && replay_next_input(rf, c, &d1, &d2)) match_step(m, d1, d2);
+}
+
+// ===== Entrada de teclado (hilo lector + colas SPSC sin locks) =====
+// th_input bloquea en poll() sobre stdin, decodifica los bytes crudos (incluidas las
+// secuencias ESC de las flechas) y encola eventos con timestamp CLOCK_MONOTONIC:
+//   - teclas de paleta -> g_in_play, que th_sim consume al inicio de cada tick;
+//   - pausa, salir y Enter -> g_in_ctl, que consume el bucle de play_screen.
+// Mientras corre th_input nadie más lee stdin (play_screen no llama a getch()).
+
+#define INPUT_RING_CAP 256   // eventos por cola (potencia de 2)
+
+typedef enum {
+    IN_P1_UP = 0,
+    IN_P1_DOWN,
+    IN_P2_UP,
+    IN_P2_DOWN,
+    IN_PAUSE,
+    IN_QUIT,
+    IN_ENTER
+} InputKey;
+
+typedef struct {
+    int64_t  t_ns;    // CLOCK_MONOTONIC al volver read()
+    InputKey key;
+} InputEvent;
+
+// Cola de un productor (th_input) y un consumidor; head/tail crecen sin envolver.
+typedef struct {
+    InputEvent            ev[INPUT_RING_CAP];
+    std::atomic<uint32_t> head{0};   // solo la escribe el productor
+    std::atomic<uint32_t> tail{0};   // solo la escribe el consumidor
+} InputRing;
+
+static InputRing g_in_play;
+static InputRing g_in_ctl;
+static pthread_t th_input;
+static int       g_input_wake[2] = {-1, -1};   // pipe para despertar a th_input al terminar
+static long long g_input_dropped = 0;          // eventos descartados por cola llena
+
+/** @brief Encola un evento; false si la cola está llena. Solo desde th_input. */
+static bool input_push(InputRing* r, const InputEvent* e) {
+    uint32_t h = r->head.load(std::memory_order_relaxed);
+    if (h - r->tail.load(std::memory_order_acquire) == INPUT_RING_CAP) return false;
+    r->ev[h & (INPUT_RING_CAP - 1)] = *e;
+    r->head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+/** @brief Desencola el evento más antiguo; false si no hay. Solo desde el consumidor. */
+static bool input_pop(InputRing* r, InputEvent* e) {
+    uint32_t t = r->tail.load(std::memory_order_relaxed);
+    if (t == r->head.load(std::memory_order_acquire)) return false;
+    *e = r->ev[t & (INPUT_RING_CAP - 1)];
+    r->tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+/** @brief Descarta lo pendiente. Solo sin productor ni consumidor corriendo. */
+static void input_ring_clear(InputRing* r) {
+    r->tail.store(r->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/** @brief Decodifica un byte crudo de la terminal (cbreak, sin keypad).
+ *  @param state 0 normal, 1 tras ESC, 2 dentro de ESC[ / ESC O (flechas).
+ *  @return true si el byte completó una tecla de juego (en *out).
+ */
+static bool input_decode(int* state, unsigned char c, InputKey* out) {
+    if (*state == 1) {
+        if (c == '[' || c == 'O') { *state = 2; return false; }
+        *state = 0;   // ESC suelto (sin acción en juego): c es una tecla aparte
+    }
+    if (*state == 2) {
+        if ((c >= '0' && c <= '9') || c == ';') return false;   // parámetros (ESC[1;2A)
+        *state = 0;
+        if (c == 'A') { *out = IN_P2_UP;   return true; }
+        if (c == 'B') { *out = IN_P2_DOWN; return true; }
+        return false;
+    }
+    switch (c) {
+        case 0x1b: *state = 1; return false;
+        case 'w': case 'W': *out = IN_P1_UP;   return true;
+        case 's': case 'S': *out = IN_P1_DOWN; return true;
+        case 'p': case 'P': *out = IN_PAUSE;   return true;
+        case 'q': case 'Q': *out = IN_QUIT;    return true;
+        case '\r': case '\n': *out = IN_ENTER; return true;
+    }
+    return false;
+}
+
+/** @brief Hilo de entrada: poll() sobre stdin y el pipe de despertar, sin timeout. */
+static void* thread_input_func(void* arg) {
+    (void)arg;
+    const int64_t cpu0 = thread_cpu_ns();
+    int state = 0;
+    struct pollfd fds[2] = {
+        { STDIN_FILENO,     POLLIN, 0 },
+        { g_input_wake[0],  POLLIN, 0 },
+    };
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) {
+            if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) break;
+            continue;
+        }
+        unsigned char buf[64];
+        const int64_t t_wake = mono_ns();
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) break;
+
+        const int64_t t_ns = mono_ns();
+        for (ssize_t i = 0; i < n; ++i) {
+            InputEvent e;
+            if (!input_decode(&state, buf[i], &e.key)) continue;
+            e.t_ns = t_ns;
+            InputRing* r = (e.key <= IN_P2_DOWN) ? &g_in_play : &g_in_ctl;
+            if (!input_push(r, &e)) g_input_dropped++;
+        }
+        trace_span(&g_tr_input, "teclas", t_wake, mono_ns());
+    }
+    g_ts_input.cpu_ns += thread_cpu_ns() - cpu0;
+    return NULL;
+}
+
+/** @brief Vacía las colas y lanza th_input (desde play_screen). */
+static bool input_start(void) {
+    if (pipe(g_input_wake) != 0) return false;
+    input_ring_clear(&g_in_play);
+    input_ring_clear(&g_in_ctl);
+    if (pthread_create(&th_input, NULL, thread_input_func, NULL) != 0) {
+        close(g_input_wake[0]);
+        close(g_input_wake[1]);
+        return false;
+    }
+    return true;
+}
+
+/** @brief Despierta a th_input por el pipe y espera a que termine. */
+static void input_stop(void) {
+    if (write(g_input_wake[1], "", 1) < 0) { /* pipe cerrado: th_input ya terminó */ }
+    pthread_join(th_input, NULL);
+    close(g_input_wake[0]);
+    close(g_input_wake[1]);
+    g_input_wake[0] = g_input_wake[1] = -1;
+}
+
+// ===== Latencia entrada -> pantalla (por tecla de paleta) =====
+// Cada tecla aplicada a una paleta humana deja en g_lat_ring su t_read (th_input), su
+// t_apply (tick de th_sim que la usa en move_paddle) y la fila dibujada de esa paleta
+// en ese momento. La snapshot lleva input_seq = teclas aplicadas; tras cada
+// doupdate()/write() el renderer cierra con t_photon las teclas cuya paleta ya se ve
+// en otra fila. Con aceleración el primer tick mueve menos de una celda, así que el
+// primer frame tras t_apply todavía no muestra nada: lo que se mide es el cambio visible.
+// Las teclas que no mueven la paleta (contra el borde) se descartan a LAT_GIVEUP_NS.
+
+#define LAT_RING_CAP    1024        // teclas aplicadas aún sin cerrar (potencia de 2)
+#define LAT_GIVEUP_NS   500000000LL // tecla sin cambio de fila: se descarta
+
+typedef struct {
+    int64_t t_read;    // read() de th_input
+    int64_t t_apply;   // inicio del tick que la aplica
+    int     player;    // paleta que mueve (1 o 2)
+    int     row0;      // fila dibujada de esa paleta en t_apply
+} LatPending;
+
+static LatPending g_lat_ring[LAT_RING_CAP];   // lo escribe th_sim
+static bool       g_lat_closed[LAT_RING_CAP]; // cerradas fuera de orden (renderer)
+static uint32_t   g_lat_shown = 0;            // teclas anteriores ya cerradas (renderer)
+static long long  g_lat_unmoved = 0;          // descartadas sin cambio de fila (renderer)
+static Histogram  g_lat_in_phys;              // t_apply - t_read    (renderer)
+static Histogram  g_lat_phys_photon;          // t_photon - t_apply  (renderer)
+static Histogram  g_lat_total;                // t_photon - t_read   (renderer)
+
+/** @brief Registra que el tick que empieza en t_apply aplica a player una tecla leída en t_read.
+ *  @note Solo th_sim, con g_lock tomado (la publica la próxima snapshot).
+ */
+static void latency_applied(int64_t t_read, int64_t t_apply, int player) {
+    LatPending* p = &g_lat_ring[g_input_applied & (LAT_RING_CAP - 1)];
+    p->t_read  = t_read;
+    p->t_apply = t_apply;
+    p->player  = player;
+    p->row0    = (int)(player == 1 ? g_match.pad1.y : g_match.pad2.y);
+    g_input_applied++;
+}
+
+/** @brief Tras presentar s, cierra las teclas cuya paleta ya se dibuja en otra fila. */
+static void latency_presented(const WorldSnapshot* s) {
+    if (s->input_seq == g_lat_shown) return;
+    const int64_t t_photon = mono_ns();
+    if (s->input_seq - g_lat_shown > LAT_RING_CAP) {
+        for (uint32_t i = 0; i < LAT_RING_CAP; ++i) g_lat_closed[i] = false;
+        g_lat_shown = s->input_seq - LAT_RING_CAP;
+    }
+    const int row1 = (int)s->pad1.y, row2 = (int)s->pad2.y;
+    for (uint32_t i = g_lat_shown; i != s->input_seq; ++i) {
+        bool* closed = &g_lat_closed[i & (LAT_RING_CAP - 1)];
+        if (*closed) continue;
+        const LatPending* p = &g_lat_ring[i & (LAT_RING_CAP - 1)];
+        if ((p->player == 1 ? row1 : row2) != p->row0) {
+            hist_record(&g_lat_in_phys,     p->t_apply - p->t_read);
+            hist_record(&g_lat_phys_photon, t_photon - p->t_apply);
+            hist_record(&g_lat_total,       t_photon - p->t_read);
+            *closed = true;
+        } else if (t_photon - p->t_apply > LAT_GIVEUP_NS) {
+            g_lat_unmoved++;
+            *closed = true;
+        }
+    }
+    while (g_lat_shown != s->input_seq && g_lat_closed[g_lat_shown & (LAT_RING_CAP - 1)]) {
+        g_lat_closed[g_lat_shown & (LAT_RING_CAP - 1)] = false;
+        ++g_lat_shown;
+    }
+}
+
+/** @brief Imprime p50/p95/p99 de cada etapa (para el perfil de salida). */
+static void latency_report(void) {
+    if (g_lat_total.n == 0) return;
+    printf("\n--- LATENCIA ENTRADA -> PANTALLA (%llu teclas, hasta que la paleta cambia de fila) ---\n",
+           (unsigned long long)g_lat_total.n);
+    struct { const char* name; const Histogram* h; } stages[] = {
+        { "Entrada->fisica",  &g_lat_in_phys },
+        { "Fisica->pantalla", &g_lat_phys_photon },
+        { "Total",            &g_lat_total },
+    };
+    for (auto& st : stages) {
+        printf("%-17s p50 %.2f ms  p95 %.2f ms  p99 %.2f ms\n", st.name,
+               hist_percentile(st.h, 0.50) / 1e6,
+               hist_percentile(st.h, 0.95) / 1e6,
+               hist_percentile(st.h, 0.99) / 1e6);
+    }
+    if (g_lat_unmoved > 0) printf("Sin cambio de fila (descartadas): %lld\n", g_lat_unmoved);
+}
+
+/** @brief Aplica las teclas de paleta pendientes a los contadores HOLD.
+ *  @details Los contadores decaen un tick de simulación por llamada; una tecla
+ *           recibida en este tick queda activa HOLD_FRAMES ticks (cubre el hueco
+ *           hasta la repetición de teclado). Solo th_sim, con g_lock tomado.
+ *  @param ticking true si a continuación corre sim_tick() (si no, la tecla no
+ *                 mueve nada y no entra en las métricas de latencia).
+ */
+static void input_consume(bool ticking) {
+    if (g_p1_hold_up   > 0) g_p1_hold_up--;
+    if (g_p1_hold_down > 0) g_p1_hold_down--;
+    if (g_p2_hold_up   > 0) g_p2_hold_up--;
+    if (g_p2_hold_down > 0) g_p2_hold_down--;
+
+    const int64_t t_apply = ticking ? mono_ns() : 0;
+    InputEvent e;
+    while (input_pop(&g_in_play, &e)) {
+        // Solo las teclas de paletas humanas (en JvC las flechas no mueven nada).
+        const int player = (e.key <= IN_P1_DOWN) ? 1 : 2;
+        const bool human = (player == 1) ? g_game_mode != MODE_CVC : g_game_mode == MODE_PVP;
+        if (ticking && human) latency_applied(e.t_ns, t_apply, player);
+        switch (e.key) {
+            case IN_P1_UP:   g_p1_hold_up   = HOLD_FRAMES; g_p1_hold_down = 0; break;
+            case IN_P1_DOWN: g_p1_hold_down = HOLD_FRAMES; g_p1_hold_up   = 0; break;
+            case IN_P2_UP:   g_p2_hold_up   = HOLD_FRAMES; g_p2_hold_down = 0; break;
+            case IN_P2_DOWN: g_p2_hold_down = HOLD_FRAMES; g_p2_hold_up   = 0; break;
+            default: break;
+        }
+    }
+}
+
+/** @brief Dirección de una paleta humana según las teclas sostenidas (HOLD_FRAMES). */
+static int human_dir(int player) {
+    int up   = (player == 1) ? g_p1_hold_up   : g_p2_hold_up;
+    int down = (player == 1) ? g_p1_hold_down : g_p2_hold_down;
+    if (up   > 0 && down == 0) return -1;
+    if (down > 0 && up   == 0) return +1;
+    return 0;
+}
+
+/** @brief Un tick de simulación interactiva en orden fijo: paleta 1, paleta 2, bola.
+ *  @note Se llama con g_lock tomado. Registra la duración de cada etapa en prof.
+ */
+static void sim_tick(SimProfile* prof) {
+    const int64_t t0 = mono_ns();
+    int dir1 = (g_game_mode == MODE_CVC) ? match_cpu_dir(&g_match, 1) : human_dir(1);
+    move_paddle(&g_match, &g_match.pad1, dir1);
+    const int64_t t1 = mono_ns();
+
+    int dir2 = (g_game_mode == MODE_PVP) ? human_dir(2) : match_cpu_dir(&g_match, 2);
+    move_paddle(&g_match, &g_match.pad2, dir2);
+    const int64_t t2 = mono_ns();
+
+    match_ball_step(&g_match);
+    g_match.ticks++;
+    const int64_t t3 = mono_ns();
+
+    hist_record(&prof->p1,   t1 - t0);
+    hist_record(&prof->p2,   t2 - t1);
+    hist_record(&prof->ball, t3 - t2);
+    trace_span(&g_tr_sim, "paleta 1", t0, t1);
+    trace_span(&g_tr_sim, "paleta 2", t1, t2);
+    trace_span(&g_tr_sim, "bola",     t2, t3);
+    replay_rec_tick(&g_rec, &g_match, dir1, dir2);
+}
+
+/** @brief Suma ns a un timespec normalizando tv_nsec. */
+static void timespec_add_ns(struct timespec* t, long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) { t->tv_nsec -= 1000000000L; t->tv_sec++; }
+}
+
+/** @brief Diferencia a - b en ns. */
+static long long timespec_diff_ns(const struct timespec* a, const struct timespec* b) {
+    return (long long)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+/** @brief Hilo de simulación: paso fijo con acumulador y deadlines absolutos.
+ *  @details
+ *   - Cada deadline vencido ejecuta un sim_tick(); si el hilo se atrasa, recupera
+ *     hasta SIM_MAX_CATCHUP ticks seguidos y descarta el resto (cuenta en g_sim_dropped).
+ *   - Duerme con clock_nanosleep(TIMER_ABSTIME) hasta el siguiente deadline, así el
+ *     tiempo de trabajo no se acumula como deriva.
+ */
+static void* thread_sim_func(void* arg) {
+    (void)arg;
+    SimProfile prof;   // propio de este hilo: se graba sin locks
+    memset(&prof, 0, sizeof(prof));
+    const int64_t cpu0 = thread_cpu_ns();
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (g_threads_should_run) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        int steps = 0;
+        while (timespec_diff_ns(&now, &next) >= 0 && steps < SIM_MAX_CATCHUP) {
+            const int64_t t_req = mono_ns();
+            lock_timed(&g_lock, &g_ts_sim);
+            trace_span(&g_tr_sim, "espera g_lock", t_req, g_ts_sim.lock_t0);
+            const bool ticking = !g_paused.load(std::memory_order_acquire) && !match_finished(&g_match);
+            input_consume(ticking);
+            if (ticking) sim_tick(&prof);
+            snapshot_publish();
+            trace_span(&g_tr_sim, "tick (g_lock)", g_ts_sim.lock_t0, mono_ns());
+            unlock_timed(&g_lock, &g_ts_sim);
+            timespec_add_ns(&next, TICK_NSEC_PLAY);
+            steps++;
+            g_sim_ticks++;
+        }
+        if (steps > 1) g_sim_late += steps - 1;
+
+        // Demasiado atrasado: reancla el reloj en vez de simular en ráfaga.
+        long long behind = timespec_diff_ns(&now, &next);
+        if (behind >= 0) {
+            g_sim_dropped += behind / TICK_NSEC_PLAY + 1;
+            next = now;
+            timespec_add_ns(&next, TICK_NSEC_PLAY);
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    // Única escritura sobre g_prof_sim; play_screen la ve tras el pthread_join.
+    hist_merge(&g_prof_sim.p1,   &prof.p1);
+    hist_merge(&g_prof_sim.p2,   &prof.p2);
+    hist_merge(&g_prof_sim.ball, &prof.ball);
+    g_ts_sim.cpu_ns += thread_cpu_ns() - cpu0;
+    return NULL;
+}
+
+/** @brief Modo headless: juega n_matches partidas CVC sin terminal ni sleeps.
+ *  @details Usa instancias locales de Match (no toca g_match) y reporta
+ *           resultados y ticks por segundo en stdout.
+ */
+static int run_headless(long n_matches) {
+    long wins1 = 0, wins2 = 0;
+    long long total_ticks = 0;
+
+    auto start = high_resolution_clock::now();
+    for (long i = 0; i < n_matches; ++i) {
+        Match m;
+        match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, (uint64_t)i));
+        while (!match_finished(&m) && m.ticks < HEADLESS_MAX_TICKS) {
+            int dir1 = match_cpu_dir(&m, 1);
+            int dir2 = match_cpu_dir(&m, 2);
+            match_step(&m, dir1, dir2);
+        }
+        if (m.score.p1 > m.score.p2) wins1++;
+        else if (m.score.p2 > m.score.p1) wins2++;
+        total_ticks += m.ticks;
+    }
+    auto end = high_resolution_clock::now();
+    double secs = duration<double>(end - start).count();
+
+    printf("--- HEADLESS CVC ---\n");
+    printf("Partidas: %ld (campo %dx%d)\n", n_matches, HEADLESS_COLS, HEADLESS_LINES);
+    printf("Semilla: %llu\n", (unsigned long long)g_seed);
+    printf("IA: %s (reaccion %d, error %.2f, %d%%)\n", g_cpu_config->name, g_cpu_config->reaction_delay,
+           (double)g_cpu_config->error_margin, g_cpu_config->error_pct);
+    printf("Victorias CPU 1: %ld\n", wins1);
+    printf("Victorias CPU 2: %ld\n", wins2);
+    printf("Ticks totales: %lld\n", total_ticks);
+    printf("Tiempo: %.4f s\n", secs);
+    printf("Ticks/s: %.0f\n", secs > 0 ? total_ticks / secs : 0.0);
+    return 0;
+}
+
+// ===== Pool de hilos con robo de trabajo =====
+// Las tareas son índices 0..n-1 conocidos de antemano (no se crean tareas nuevas).
+// Cada worker arranca con un rango contiguo [head, tail) en su deque: saca del final
+// (LIFO, localidad) y, cuando se queda sin trabajo, roba del principio de la deque de
+// otro worker elegido al azar. Sin trabajo en ninguna deque, el worker termina.
+
+typedef struct {
+    pthread_mutex_t lock;
+    long head, tail;       // tareas pendientes: [head, tail)
+} WsDeque;
+
+typedef struct {
+    int       n_workers;
+    WsDeque*  deques;
+    void    (*run)(void* ctx, long task);
+    void*     ctx;
+} WsPool;
+
+typedef struct {
+    WsPool*   pool;
+    int       id;
+    long long done, steals;
+} WsWorker;
+
+/** @brief Saca la tarea más reciente de la deque propia. */
+static bool ws_pop(WsDeque* d, long* task) {
+    pthread_mutex_lock(&d->lock);
+    bool ok = d->head < d->tail;
+    if (ok) *task = --d->tail;
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/** @brief Roba la tarea más vieja de la deque de otro worker. */
+static bool ws_steal(WsDeque* d, long* task) {
+    pthread_mutex_lock(&d->lock);
+    bool ok = d->head < d->tail;
+    if (ok) *task = d->head++;
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/** @brief Bucle de un worker: deque propia, luego robo desde una víctima al azar. */
+static void* ws_worker_func(void* arg) {
+    WsWorker* w = (WsWorker*)arg;
+    WsPool* p = w->pool;
+    Rng rng;
+    rng_seed(&rng, match_seed(0x5EED, (uint64_t)w->id));
+    for (;;) {
+        long task;
+        bool got = ws_pop(&p->deques[w->id], &task);
+        for (int k = 0, v0 = (int)rng_below(&rng, p->n_workers); !got && k < p->n_workers; ++k) {
+            int v = (v0 + k) % p->n_workers;
+            if (v != w->id && ws_steal(&p->deques[v], &task)) { got = true; w->steals++; }
+        }
+        if (!got) break;
+        p->run(p->ctx, task);
+        w->done++;
+    }
+    return NULL;
+}
+
+/** @brief Ejecuta run(ctx, i) para i en [0, n_tasks) con n_workers hilos.
+ *  @param steals si no es NULL, recibe el total de robos.
+ *  @return false si no se pudo crear ningún hilo (en ese caso corre todo en el llamador).
+ */
+static bool ws_run(long n_tasks, int n_workers, void (*run)(void*, long), void* ctx, long long* steals) {
+    if (n_workers < 1) n_workers = 1;
+    WsPool pool = { n_workers, NULL, run, ctx };
+    pool.deques = (WsDeque*)calloc((size_t)n_workers, sizeof(WsDeque));
+    WsWorker*  workers = (WsWorker*)calloc((size_t)n_workers, sizeof(WsWorker));
+    pthread_t* th      = (pthread_t*)calloc((size_t)n_workers, sizeof(pthread_t));
+    bool ok = pool.deques && workers && th;
+    if (ok) {
+        for (int i = 0; i < n_workers; ++i) {
+            pthread_mutex_init(&pool.deques[i].lock, NULL);
+            pool.deques[i].head = n_tasks * i / n_workers;
+            pool.deques[i].tail = n_tasks * (i + 1) / n_workers;
+            workers[i].pool = &pool;
+            workers[i].id = i;
+        }
+        // El worker 0 es el hilo llamador; si un pthread_create falla, sus tareas se roban igual.
+        for (int i = 1; i < n_workers; ++i) {
+            if (pthread_create(&th[i], NULL, ws_worker_func, &workers[i]) != 0) th[i] = 0;
+        }
+        ws_worker_func(&workers[0]);
+        long long total_steals = 0;
+        for (int i = 0; i < n_workers; ++i) {
+            if (i > 0 && th[i]) pthread_join(th[i], NULL);
+            total_steals += workers[i].steals;
+            pthread_mutex_destroy(&pool.deques[i].lock);
+        }
+        if (steals) *steals = total_steals;
+    } else {
+        for (long t = 0; t < n_tasks; ++t) run(ctx, t);
+        if (steals) *steals = 0;
+    }
+    free(pool.deques);
+    free(workers);
+    free(th);
+    return ok;
+}
+
+// ===== Simulación por lotes SoA (--headless --batch N) =====
+// N partidas CVC independientes guardadas como arreglos paralelos (un arreglo por campo,
+// un carril por partida). Cada tick avanza todos los carriles con un kernel vectorial:
+// IA con retardo, move_paddle, rebote en techo/piso, cruce de la cara de cada paleta y
+// goles. El ancho sale de la CPU en tiempo de ejecución: AVX2 (8 carriles), SSE4.1 (4)
+// o escalar. Los eventos raros (saque, golpe de paleta que obliga a replanear la IA,
+// fin de partida) se atienden carril por carril con el código de Match; un carril
+// cuya partida termina se recarga con la siguiente y, sin partidas pendientes, queda
+// libre con la bola quieta.
+// La física es float (también con -DPONG_FIXED_POINT) y simplificada respecto de
+// match_ball_step: a lo sumo un rebote de pared y un golpe de paleta por tick, sin
+// barrido multi-contacto (|vx| <= BALL_SPEED_MAX < 1 celda/tick). No reproduce
+// match_step bit a bit, pero cada partida depende solo de su semilla: los totales
+// no cambian con los carriles, los hilos ni el ISA.
+
+#define BATCH_LANES_DEFAULT 256
+#define BATCH_LANE_ALIGN    16      // carriles múltiplo de 16: arreglos de 64 bytes, ancho AVX2 x2
+
+#define BATCH_EV_HIT   1            // golpe de paleta: la IA que recibe replanea
+#define BATCH_EV_GOAL1 2            // punto para la paleta 1 (bola salió por la derecha)
+#define BATCH_EV_GOAL2 4            // punto para la paleta 2
+#define BATCH_EV_CAP   8            // tope de ticks (o carril libre)
+
+typedef enum {
+    BATCH_ISA_SCALAR = 0,
+    BATCH_ISA_SSE,
+    BATCH_ISA_AVX2
+} BatchIsa;
+
+static const char* const BATCH_ISA_NAME[] = { "scalar", "sse4.1", "avx2" };
+
+typedef struct {
+    int      n;                         // carriles
+    int      active;                    // el kernel recorre [0, active); el resto está libre
+    float   *bx, *by, *bvx, *bvy;       // bola
+    float   *p1y, *p1vy, *p2y, *p2vy;   // paletas
+    float   *t1, *t2;                   // fila objetivo de cada IA (con TRACK: error de puntería)
+    int32_t *s1, *s2;                   // marcador
+    int32_t *c1, *c2;                   // contadores de reacción
+    int32_t *ticks;
+    Rng     *rng, *rng1, *rng2;         // saques y errores de cada IA (solo en eventos)
+    long    *match;                     // partida cargada en el carril (-1 = libre)
+    void    *mem;
+    Match            field;             // geometría (match_init) y plantilla para los eventos
+    const CpuConfig *cfg1, *cfg2;
+    long      next, end;                // partidas por cargar: [next, end)
+    int       live;                     // carriles con partida
+    long      wins1, wins2;
+    long long total_ticks;
+} BatchSim;
+
+/** @brief Elige el plan de la IA que recibe la bola con cpu_calculate_direction() sobre
+ *         una copia del carril (mismo error y misma predicción que en Match).
+ */
+static void batch_plan(BatchSim* b, int k) {
+    Match m = b->field;
+    m.ball.x = num_t(b->bx[k]);   m.ball.y = num_t(b->by[k]);
+    m.ball.vx = num_t(b->bvx[k]); m.ball.vy = num_t(b->bvy[k]);
+    m.pad1.y = num_t(b->p1y[k]);  m.pad2.y = num_t(b->p2y[k]);
+    m.cpu1.cfg = b->cfg1; m.cpu1.rng = b->rng1[k]; m.cpu1.plan_gen = 0;
+    m.cpu2.cfg = b->cfg2; m.cpu2.rng = b->rng2[k]; m.cpu2.plan_gen = 0;
+    m.traj_gen = 1;
+    cpu_calculate_direction(&m, 1);
+    cpu_calculate_direction(&m, 2);
+    if (m.cpu1.plan_gen) {
+        b->rng1[k] = m.cpu1.rng;
+        b->t1[k] = (float)(b->cfg1->strategy == CPU_STRAT_TRACK ? m.cpu1.aim_err : m.cpu1.target_y);
+    }
+    if (m.cpu2.plan_gen) {
+        b->rng2[k] = m.cpu2.rng;
+        b->t2[k] = (float)(b->cfg2->strategy == CPU_STRAT_TRACK ? m.cpu2.aim_err : m.cpu2.target_y);
+    }
+}
+
+/** @brief Carga en el carril k la próxima partida pendiente (match_init), o lo libera. */
+static void batch_load(BatchSim* b, int k) {
+    Match m;
+    const bool has_match = b->next < b->end;
+    const long idx = has_match ? b->next++ : -1;
+    match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, has_match ? (uint64_t)idx : 0));
+    if (!has_match) {
+        m.ball.vx = 0; m.ball.vy = 0;
+        if (b->match[k] >= 0) b->live--;
+    } else if (b->match[k] < 0) {
+        b->live++;
+    }
+    b->match[k] = idx;
+    b->bx[k] = (float)m.ball.x;   b->by[k] = (float)m.ball.y;
+    b->bvx[k] = (float)m.ball.vx; b->bvy[k] = (float)m.ball.vy;
+    b->p1y[k] = (float)m.pad1.y;  b->p1vy[k] = 0;
+    b->p2y[k] = (float)m.pad2.y;  b->p2vy[k] = 0;
+    b->t1[k] = b->t2[k] = 0;
+    b->s1[k] = b->s2[k] = 0;
+    b->c1[k] = b->c2[k] = 0;
+    b->ticks[k] = 0;
+    b->rng[k] = m.rng; b->rng1[k] = m.cpu1.rng; b->rng2[k] = m.cpu2.rng;
+    if (has_match) batch_plan(b, k);
+}
+
+/** @brief Atiende los eventos del carril k: fin de partida, saque tras gol o replaneo. */
+static void batch_event(BatchSim* b, int k, int ev) {
+    if (b->match[k] < 0) { b->ticks[k] = 0; return; }
+    if (b->s1[k] >= SCORE_TO_WIN || b->s2[k] >= SCORE_TO_WIN || b->ticks[k] >= HEADLESS_MAX_TICKS) {
+        if (b->s1[k] > b->s2[k]) b->wins1++;
+        else if (b->s2[k] > b->s1[k]) b->wins2++;
+        b->total_ticks += b->ticks[k];
+        batch_load(b, k);
+        return;
+    }
+    if (ev & (BATCH_EV_GOAL1 | BATCH_EV_GOAL2)) {
+        Match m = b->field;
+        m.rng = b->rng[k];
+        ball_spawn_random(&m, (ev & BATCH_EV_GOAL2) != 0);   // igual que match_ball_step
+        b->rng[k] = m.rng;
+        b->bx[k] = (float)m.ball.x;   b->by[k] = (float)m.ball.y;
+        b->bvx[k] = (float)m.ball.vx; b->bvy[k] = (float)m.ball.vy;
+    }
+    batch_plan(b, k);
+}
+
+/** @brief Reserva n carriles (redondeado a BATCH_LANE_ALIGN) y carga las partidas [begin, end). */
+static bool batch_init(BatchSim* b, int n, long begin, long end, const CpuConfig* cfg1, const CpuConfig* cfg2) {
+    memset(b, 0, sizeof(*b));
+    n = (n + BATCH_LANE_ALIGN - 1) / BATCH_LANE_ALIGN * BATCH_LANE_ALIGN;
+    if (n < BATCH_LANE_ALIGN) n = BATCH_LANE_ALIGN;
+    const size_t words = (size_t)n * 4;   // bytes de un arreglo de 32 bits (múltiplo de 64)
+    const size_t bytes = words * 15 + (size_t)n * (3 * sizeof(Rng) + sizeof(long));
+    char* p = (char*)aligned_alloc(64, (bytes + 63) / 64 * 64);
+    if (!p) return false;
+    b->mem = p;
+    float** fl[] = { &b->bx, &b->by, &b->bvx, &b->bvy, &b->p1y, &b->p1vy, &b->p2y, &b->p2vy, &b->t1, &b->t2 };
+    for (float** a : fl) { *a = (float*)p; p += words; }
+    int32_t** in[] = { &b->s1, &b->s2, &b->c1, &b->c2, &b->ticks };
+    for (int32_t** a : in) { *a = (int32_t*)p; p += words; }
+    b->rng  = (Rng*)p; p += (size_t)n * sizeof(Rng);
+    b->rng1 = (Rng*)p; p += (size_t)n * sizeof(Rng);
+    b->rng2 = (Rng*)p; p += (size_t)n * sizeof(Rng);
+    b->match = (long*)p;
+    b->n = n;
+    b->active = n;
+    b->cfg1 = cfg1;
+    b->cfg2 = cfg2;
+    b->next = begin;
+    b->end = end;
+    match_init(&b->field, HEADLESS_LINES, HEADLESS_COLS, 0);
+    for (int k = 0; k < n; ++k) b->match[k] = -1;
+    for (int k = 0; k < n; ++k) batch_load(b, k);
+    return true;
+}
+
+/** @brief Mueve la partida del carril src a dst (libre) y libera src. */
+static void batch_move(BatchSim* b, int dst, int src) {
+    float*   fl[] = { b->bx, b->by, b->bvx, b->bvy, b->p1y, b->p1vy, b->p2y, b->p2vy, b->t1, b->t2 };
+    int32_t* in[] = { b->s1, b->s2, b->c1, b->c2, b->ticks };
+    for (float* a : fl) a[dst] = a[src];
+    for (int32_t* a : in) a[dst] = a[src];
+    b->rng[dst] = b->rng[src];
+    b->rng1[dst] = b->rng1[src];
+    b->rng2[dst] = b->rng2[src];
+    b->match[dst] = b->match[src];
+    b->match[src] = -1;
+    batch_load(b, src);   // sin partidas pendientes: queda libre
+}
+
+/** @brief Cola de la corrida (sin partidas por cargar): junta los carriles con partida
+ *         al principio para que el kernel no recorra bloques enteros de carriles libres.
+ */
+static void batch_compact(BatchSim* b) {
+    int dst = 0;
+    for (int k = 0; k < b->active; ++k) {
+        if (b->match[k] < 0) continue;
+        if (k != dst) batch_move(b, dst, k);
+        dst++;
+    }
+    b->active = (dst + BATCH_LANE_ALIGN - 1) / BATCH_LANE_ALIGN * BATCH_LANE_ALIGN;
+}
+
+static void batch_free(BatchSim* b) {
+    free(b->mem);
+    b->mem = NULL;
+}
+
+// Vectores de W carriles (extensiones de GCC/Clang; el target de la función elige las instrucciones).
+template <int W>
+struct BatchVec {
+    typedef float   vf __attribute__((vector_size(W * sizeof(float))));
+    typedef int32_t vi __attribute__((vector_size(W * sizeof(int32_t))));
+};
+
+// Helpers del kernel: W carriles a la vez, sin ramas (máscaras y selects). Son
+// always_inline y reciben/devuelven vectores por referencia: nunca se pasa un vector por
+// valor entre funciones de distinto target (el ABI de los de 32 bytes cambia con AVX).
+
+/** @brief Carga/guarda W valores consecutivos (sin requisitos de alineación). */
+template <typename V, typename T>
+static inline __attribute__((always_inline)) void batch_ld(V* v, const T* p) {
+    memcpy(v, p, sizeof(*v));
+}
+
+template <typename V, typename T>
+static inline __attribute__((always_inline)) void batch_st(T* p, const V& v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+/** @brief Dirección de la IA (cpu_calculate_direction con el plan ya elegido). */
+template <typename VF, typename VI>
+static inline __attribute__((always_inline)) void batch_ai_dir(VF* dir, const VF& py, const VI& coming,
+                                                               const VF& target, float center) {
+    const VF zero = {};
+    VF diff = target - py;
+    VF chase = diff < -0.5f ? zero - 1.0f : diff > 0.5f ? zero + 1.0f : zero;
+    VF home = py < center - 1 ? zero + 1.0f : py > center + 1 ? zero - 1.0f : zero;
+    *dir = coming ? chase : home;
+}
+
+/** @brief Retardo de reacción (match_cpu_dir): la dirección solo vale cuando el contador llega a delay. */
+template <typename VF, typename VI>
+static inline __attribute__((always_inline)) void batch_react(VF* dir, VI* counter, int32_t delay) {
+    const VF zero = {};
+    const VI izero = {};
+    VI c = *counter + 1;
+    VI fire = c >= delay;
+    *counter = fire ? izero : c;
+    *dir = fire ? *dir : zero;
+}
+
+/** @brief move_paddle: aceleración, fricción sin input, tope de velocidad y límites del campo. */
+template <typename VF>
+static inline __attribute__((always_inline)) void batch_move_paddle(VF* y, VF* vy, const VF& dir,
+                                                                    float min_y, float max_y) {
+    const VF zero = {};
+    VF v = *vy + (float)(PADDLE_ACC * PADDLE_DT) * dir;
+    VF dec = v - (float)(PADDLE_FRICTION * PADDLE_DT);
+    VF inc = v + (float)(PADDLE_FRICTION * PADDLE_DT);
+    dec = dec < 0 ? zero : dec;
+    inc = inc > 0 ? zero : inc;
+    auto idle = dir == 0;
+    v = (idle & (v > 0)) ? dec : (idle & (v < 0)) ? inc : v;
+    v = v > (float)PADDLE_MAX_V ? zero + (float)PADDLE_MAX_V : v;
+    v = v < -(float)PADDLE_MAX_V ? zero - (float)PADDLE_MAX_V : v;
+    VF p = *y + v * (float)PADDLE_DT;
+    auto lo = p < min_y, hi = p > max_y;
+    p = lo ? zero + min_y : hi ? zero + max_y : p;
+    *vy = (lo | hi) ? zero : v;
+    *y = p;
+}
+
+/** @brief Lleva y a [lo, hi] reflejando (un rebote a lo sumo). */
+template <typename VF>
+static inline __attribute__((always_inline)) void batch_fold(VF* y, float lo, float hi) {
+    const VF zero = {};
+    VF r = *y;
+    r = r < lo ? 2 * lo - r : r;
+    r = r > hi ? 2 * hi - r : r;
+    *y = r < lo ? zero + lo : r;
+}
+
+/** @brief Golpe en la cara de una paleta cruzada este tick (paddle_hits_row en la fila
+ *         de cruce). dy: fila de cruce menos fila de la paleta.
+ */
+template <typename VF, typename VI>
+static inline __attribute__((always_inline)) void batch_pad_hit(VI* hit, VI* dy, const VI& crossing, float face,
+                                                                const VF& bx, const VF& by, const VF& bvx,
+                                                                const VF& bvy, const VF& py,
+                                                                float wall_top, float wall_bot) {
+    VF y = by + bvy * ((face - bx) / bvx);
+    batch_fold(&y, wall_top, wall_bot);
+    VI row = __builtin_convertvector(y, VI);
+    VI prow = __builtin_convertvector(py, VI);
+    *dy = row - prow;
+    *hit = crossing & (row >= prow - PADDLE_LEN/2) & (row <= prow + PADDLE_LEN/2);
+}
+
+/** @brief Un tick de todos los carriles, de a W. Mismas operaciones float y en el mismo
+ *         orden para cualquier W, así los resultados no dependen del ISA.
+ *  @details always_inline: se compila dentro de cada batch_tick_<isa> con su target.
+ */
+template <int W>
+static inline __attribute__((always_inline)) void batch_tick(BatchSim* b) {
+    typedef typename BatchVec<W>::vf vf;
+    typedef typename BatchVec<W>::vi vi;
+    const Match* f = &b->field;
+    const float wall_top = f->top + 1, wall_bot = f->bottom - 1;
+    const float face1 = f->pad1.x + 1, face2 = f->pad2.x - 1;
+    const float min_y = f->top + 1 + PADDLE_LEN/2, max_y = f->bottom - 1 - PADDLE_LEN/2;
+    const float center = (float)(f->top + f->bottom) / 2;
+    const bool track1 = b->cfg1->strategy == CPU_STRAT_TRACK;
+    const bool track2 = b->cfg2->strategy == CPU_STRAT_TRACK;
+    const int32_t delay1 = b->cfg1->reaction_delay, delay2 = b->cfg2->reaction_delay;
+
+    for (int i = 0; i < b->active; i += W) {
+        vf bx, by, bvx, bvy, p1y, p1vy, p2y, p2vy, t1, t2;
+        vi c1, c2, s1, s2, ticks;
+        batch_ld(&bx, b->bx + i);     batch_ld(&by, b->by + i);
+        batch_ld(&bvx, b->bvx + i);   batch_ld(&bvy, b->bvy + i);
+        batch_ld(&p1y, b->p1y + i);   batch_ld(&p1vy, b->p1vy + i);
+        batch_ld(&p2y, b->p2y + i);   batch_ld(&p2vy, b->p2vy + i);
+        batch_ld(&t1, b->t1 + i);     batch_ld(&t2, b->t2 + i);
+        batch_ld(&c1, b->c1 + i);     batch_ld(&c2, b->c2 + i);
+        batch_ld(&s1, b->s1 + i);     batch_ld(&s2, b->s2 + i);
+        batch_ld(&ticks, b->ticks + i);
+
+        // --- IA y paletas (match_step: paleta 1, paleta 2, bola) ---
+        vf d1, d2;
+        batch_ai_dir(&d1, p1y, (vi)(bvx < 0), track1 ? by + t1 : t1, center);
+        batch_ai_dir(&d2, p2y, (vi)(bvx > 0), track2 ? by + t2 : t2, center);
+        batch_react(&d1, &c1, delay1);
+        batch_react(&d2, &c2, delay2);
+        batch_move_paddle(&p1y, &p1vy, d1, min_y, max_y);
+        batch_move_paddle(&p2y, &p2vy, d2, min_y, max_y);
+
+        // --- Bola: techo/piso, caras de las paletas ---
+        vf nx = bx + bvx, ny = by + bvy;
+        vi wall = (ny < wall_top) | (ny > wall_bot);
+        batch_fold(&ny, wall_top, wall_bot);
+        vi hit1, hit2, dy1, dy2;
+        batch_pad_hit(&hit1, &dy1, (vi)((bvx < 0) & (bx >= face1) & (nx < face1)), face1, bx, by, bvx, bvy, p1y,
+                      wall_top, wall_bot);
+        batch_pad_hit(&hit2, &dy2, (vi)((bvx > 0) & (bx <= face2) & (nx > face2)), face2, bx, by, bvx, bvy, p2y,
+                      wall_top, wall_bot);
+        bvy = wall ? -bvy : bvy;
+        vi hit = hit1 | hit2;
+        nx = hit1 ? 2 * face1 - nx : hit2 ? 2 * face2 - nx : nx;
+        bvx = hit ? -bvx : bvx;
+        bvy = hit ? bvy + 0.15f * __builtin_convertvector(hit1 ? dy1 : dy2, vf) : bvy;
+
+        // --- Goles y tope de ticks ---
+        vi col = __builtin_convertvector(nx, vi);
+        vi goal2 = col <= f->left, goal1 = col >= f->right;
+        s1 -= goal1;
+        s2 -= goal2;
+        ticks += 1;
+        vi ev = (hit & BATCH_EV_HIT) | (goal1 & BATCH_EV_GOAL1) | (goal2 & BATCH_EV_GOAL2) |
+                ((ticks >= (int32_t)HEADLESS_MAX_TICKS) & BATCH_EV_CAP);
+
+        batch_st(b->bx + i, nx);      batch_st(b->by + i, ny);
+        batch_st(b->bvx + i, bvx);    batch_st(b->bvy + i, bvy);
+        batch_st(b->p1y + i, p1y);    batch_st(b->p1vy + i, p1vy);
+        batch_st(b->p2y + i, p2y);    batch_st(b->p2vy + i, p2vy);
+        batch_st(b->c1 + i, c1);      batch_st(b->c2 + i, c2);
+        batch_st(b->s1 + i, s1);      batch_st(b->s2 + i, s2);
+        batch_st(b->ticks + i, ticks);
+
+        uint32_t words[W];   // ev como enteros: el OR no extrae carril por carril
+        memcpy(words, &ev, sizeof(words));
+        uint32_t any = 0;
+        for (int k = 0; k < W; ++k) any |= words[k];
+        if (any) {
+            for (int k = 0; k < W; ++k) if (words[k]) batch_event(b, i + k, (int)words[k]);
+        }
+    }
+}
 
-    if (selected) attron(A_REVERSE);
-    mvprintw(y, x, "+-%.*s-+", inner_w, "--------------------------------");
-    mvprintw(y+1, x, "|%*s%s%*s|", left_pad, "", text, right_pad, "");
-    mvprintw(y+2, x, "+-%.*s-+", inner_w, "--------------------------------");
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))   static void batch_tick_avx2(BatchSim* b) { batch_tick<8>(b); }
+__attribute__((target("sse4.1"))) static void batch_tick_sse(BatchSim* b)  { batch_tick<4>(b); }
+#endif
+static void batch_tick_scalar(BatchSim* b) { batch_tick<1>(b); }
+
+/** @brief true si esta CPU puede correr el kernel isa. */
+static bool batch_isa_supported(BatchIsa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == BATCH_ISA_AVX2) return __builtin_cpu_supports("avx2");
+    if (isa == BATCH_ISA_SSE)  return __builtin_cpu_supports("sse4.1");
+#endif
+    return isa == BATCH_ISA_SCALAR;
+}
 
-    if (selected) attroff(A_REVERSE);
+/** @brief El kernel más ancho que soporta esta CPU. */
+static BatchIsa batch_best_isa(void) {
+    if (batch_isa_supported(BATCH_ISA_AVX2)) return BATCH_ISA_AVX2;
+    if (batch_isa_supported(BATCH_ISA_SSE))  return BATCH_ISA_SSE;
+    return BATCH_ISA_SCALAR;
 }
 
-/** @brief Crea el archivo de puntajes si no existe. */
-static void ensure_file_exists() {
-    FILE* f = fopen(LEADERBOARD_FILE, "a");
-    if (f) fclose(f);
+/** @brief Un tick del lote con el kernel isa (debe estar soportado). */
+static void batch_tick_isa(BatchSim* b, BatchIsa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == BATCH_ISA_AVX2) { batch_tick_avx2(b); return; }
+    if (isa == BATCH_ISA_SSE)  { batch_tick_sse(b);  return; }
+#endif
+    (void)isa;
+    batch_tick_scalar(b);
 }
 
-/** @brief Ordena Entry por score ganador y fecha (desc). */
-static int cmp_entry(const void* a, const void* b) {
-    const Entry* ea = (const Entry*)a;
-    const Entry* eb = (const Entry*)b;
-    if (eb->winScore != ea->winScore) return eb->winScore - ea->winScore;
-    if (eb->ts > ea->ts) return 1;
-    if (eb->ts < ea->ts) return -1;
-    return 0;
+typedef struct {
+    long      n_matches;
+    int       n_parts;     // un BatchSim por parte; las partes se reparten en el pool
+    int       lanes;
+    BatchIsa  isa;
+    BatchSim* sims;
+    bool      failed;
+} BatchRun;
+
+/** @brief Tarea del pool: corre hasta el final las partidas de la parte p. */
+static void batch_run_part(void* ctx, long p) {
+    BatchRun* r = (BatchRun*)ctx;
+    BatchSim* b = &r->sims[p];
+    const long begin = r->n_matches * p / r->n_parts, end = r->n_matches * (p + 1) / r->n_parts;
+    if (!batch_init(b, r->lanes, begin, end, g_cpu_config, g_cpu_config)) { r->failed = true; return; }
+    while (b->live > 0) {
+        batch_tick_isa(b, r->isa);
+        if (b->next >= b->end && b->live <= b->active - BATCH_LANE_ALIGN) batch_compact(b);
+    }
+    batch_free(b);
 }
 
-/** @brief Carga hasta maxn entradas del leaderboard desde CSV.
- *  @return número de entradas leídas.
+/** @brief Modo headless por lotes: n_matches partidas CVC en lotes SoA de lanes carriles,
+ *         un lote por hilo. Reporta el mismo resumen que run_headless() y match-ticks/s.
  */
-static int load_entries(Entry* arr, int maxn) {
-    ensure_file_exists();
-    FILE* f = fopen(LEADERBOARD_FILE, "r");
-    if (!f) return 0;
-    int n = 0;
-    while (n < maxn) {
-        Entry e;
-        int scanned = fscanf(f, "%24[^,],%24[^,],%d,%d,%ld\n",
-                             e.winner, e.loser, &e.winScore, &e.loseScore, &e.ts);
-        if (scanned != 5) break;
-        arr[n++] = e;
+static int run_headless_batch(long n_matches, int lanes, int n_threads, const char* isa_name) {
+    BatchIsa isa = batch_best_isa();
+    if (isa_name) {
+        int found = -1;
+        for (int i = 0; i <= BATCH_ISA_AVX2; ++i) if (strcmp(isa_name, BATCH_ISA_NAME[i]) == 0) found = i;
+        if (found < 0 || !batch_isa_supported((BatchIsa)found)) {
+            fprintf(stderr, "ISA %s no disponible en esta CPU (mejor: %s)\n", isa_name, BATCH_ISA_NAME[isa]);
+            return 1;
+        }
+        isa = (BatchIsa)found;
     }
-    fclose(f);
-    return n;
+    if (n_threads < 1) n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+    if (lanes < 1) lanes = BATCH_LANES_DEFAULT;
+
+    BatchRun r = { n_matches, n_threads, lanes, isa, NULL, false };
+    r.sims = (BatchSim*)calloc((size_t)n_threads, sizeof(BatchSim));
+    if (!r.sims) { fprintf(stderr, "Sin memoria para los lotes\n"); return 1; }
+
+    const int64_t t0 = mono_ns();
+    ws_run(n_threads, n_threads, batch_run_part, &r, NULL);
+    const double secs = (mono_ns() - t0) / 1e9;
+
+    long wins1 = 0, wins2 = 0;
+    long long total_ticks = 0;
+    for (int p = 0; p < n_threads; ++p) {
+        wins1 += r.sims[p].wins1;
+        wins2 += r.sims[p].wins2;
+        total_ticks += r.sims[p].total_ticks;
+    }
+    const int lanes_used = r.sims[0].n;
+    free(r.sims);
+    if (r.failed) { fprintf(stderr, "Sin memoria para los lotes\n"); return 1; }
+
+    printf("--- HEADLESS CVC (lotes SoA) ---\n");
+    printf("Partidas: %ld (campo %dx%d)\n", n_matches, HEADLESS_COLS, HEADLESS_LINES);
+    printf("Semilla: %llu\n", (unsigned long long)g_seed);
+    printf("IA: %s (reaccion %d, error %.2f, %d%%)\n", g_cpu_config->name, g_cpu_config->reaction_delay,
+           (double)g_cpu_config->error_margin, g_cpu_config->error_pct);
+    printf("Lotes: %d x %d carriles, kernel %s\n", n_threads, lanes_used, BATCH_ISA_NAME[isa]);
+    printf("Victorias CPU 1: %ld\n", wins1);
+    printf("Victorias CPU 2: %ld\n", wins2);
+    printf("Ticks totales: %lld\n", total_ticks);
+    printf("Tiempo: %.4f s\n", secs);
+    printf("Ticks/s: %.0f\n", secs > 0 ? total_ticks / secs : 0.0);
+    return 0;
 }
 
-/** @brief Agrega una entrada al leaderboard (append CSV). */
-static void append_entry(const Entry* e) {
-    ensure_file_exists();
-    FILE* f = fopen(LEADERBOARD_FILE, "a");
-    if (!f) return;
-    fprintf(f, "%s,%s,%d,%d,%ld\n", e->winner, e->loser, e->winScore, e->loseScore, (long)e->ts);
-    fclose(f);
+// ===== Torneo de configuraciones de IA (--tournament) =====
+// Grilla de CpuConfig (retardo x error x estrategia) jugando CVC headless entre sí,
+// todo contra todos o suizo, repartido en el pool. Cada partida escribe solo su
+// casilla de resultados; Elo y tabla se calculan después en orden fijo, así que el
+// resultado depende de la semilla y no del número de hilos ni del reparto.
+// Las partidas se juegan hasta SCORE_TO_WIN como en el juego. Las que llegan al tope de
+// seguridad HEADLESS_MAX_TICKS (rallies sin fin entre IAs que no fallan) no tienen
+// resultado: se cuentan aparte y quedan fuera de Elo, tabla y salida por partida.
+
+#define TOURNEY_ELO_START 1500.0
+#define TOURNEY_ELO_K     16.0
+#define TOURNEY_OUT       "pong_tournament.txt"
+
+typedef enum {
+    TOURNEY_ROUND_ROBIN = 0,
+    TOURNEY_SWISS
+} TourneyFormat;
+
+typedef struct {
+    int  a, b;           // índices de config: a juega como paleta 1, b como paleta 2
+    int  s1, s2;         // marcador final
+    long ticks;
+    bool capped;         // cortada por HEADLESS_MAX_TICKS sin llegar a SCORE_TO_WIN
+} TourneyGame;
+
+typedef struct {
+    const CpuConfig* configs;
+    TourneyGame*     games;
+    uint64_t         seed_base;   // semilla de la ronda
+} TourneyBatch;
+
+typedef struct {
+    int    wins, losses;
+    int    capped;       // partidas cortadas por el tope (sin resultado)
+    double elo;
+    double points;       // 1 por serie ganada, 0.5 por serie empatada (orden del suizo)
+} TourneyStanding;
+
+static const char* const CPU_STRAT_NAME[] = { "pred", "lineal", "sigue" };
+
+/** @brief Tarea del pool: juega la partida i del lote con su propia semilla. */
+static void tourney_play(void* ctx, long i) {
+    TourneyBatch* t = (TourneyBatch*)ctx;
+    TourneyGame* g = &t->games[i];
+    Match m;
+    match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(t->seed_base, (uint64_t)i));
+    m.cpu1.cfg = &t->configs[g->a];
+    m.cpu2.cfg = &t->configs[g->b];
+    while (!match_finished(&m) && m.ticks < HEADLESS_MAX_TICKS) {
+        int dir1 = match_cpu_dir(&m, 1);
+        int dir2 = match_cpu_dir(&m, 2);
+        match_step(&m, dir1, dir2);
+    }
+    g->s1 = m.score.p1;
+    g->s2 = m.score.p2;
+    g->ticks = m.ticks;
+    g->capped = !match_finished(&m);
 }
 
-/** @brief Lee una línea de texto (bloqueante) con edición básica en ncurses.
- *  @param out buffer destino (maxlen + '\0')
- *  @note Muestra y posiciona cursor temporalmente.
- */
-static void read_line_ncurses(char* out, int maxlen, int y, int x) {
-    int len = 0;
-    out[0] = '\0';
-    move(y, x);
-    curs_set(1);
-    while (1) {
-        int ch = getch();
-        if (ch == '\n' || ch == KEY_ENTER) break;
-        else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
-            if (len > 0) {
-                len--;
-                out[len] = '\0';
-                mvaddch(y, x+len, ' ');
-                move(y, x+len);
-            }
-        } else if (ch >= 32 && ch <= 126) {
-            if (len < maxlen) {
-                out[len++] = (char)ch;
-                out[len] = '\0';
-                mvaddch(y, x+len-1, ch);
+/** @brief Llena la grilla de configuraciones. @return cantidad. */
+static int tourney_make_configs(CpuConfig* out) {
+    static const int   delays[]  = { 1, 3, 6 };
+    static const float margins[] = { 0.0f, 1.5f, 3.0f };
+    int n = 0;
+    for (int s = 0; s < 3; ++s) {
+        for (int d = 0; d < 3; ++d) {
+            for (int e = 0; e < 3; ++e) {
+                CpuConfig* c = &out[n++];
+                c->reaction_delay = delays[d];
+                c->error_margin   = margins[e];
+                c->error_pct      = CPU_ERROR_PCT;
+                c->strategy       = (CpuStrategy)s;
+                snprintf(c->name, sizeof(c->name), "R%d-E%.1f-%s", c->reaction_delay,
+                         (double)c->error_margin, CPU_STRAT_NAME[s]);
             }
         }
-        refresh();
     }
-    curs_set(0);
-    if (len == 0) strncpy(out, "Jugador", maxlen);
+    return n;
 }
 
-/** @brief IA: decide dirección de movimiento (-1,0,+1) para una paleta CPU.
- *  @details Reacciona solo si la bola va hacia la paleta; en caso contrario,
- *           vuelve hacia el centro. Inyecta error aleatorio (CPU_ERROR_MARGIN).
+/** @brief Aplica Elo y G/P de las partidas en orden, y escribe cada una como Entry.
+ *  @note Las partidas cortadas por el tope solo suman a capped: un marcador parcial no
+ *        dice quién gana una partida a SCORE_TO_WIN.
  */
-static int cpu_calculate_direction(Paddle* cpu_paddle, Ball ball) {
-    // Solo reaccionar si la pelota viene hacia la CPU
-    bool ball_coming = (cpu_paddle->x > g_midX && ball.vx > 0) || 
-                       (cpu_paddle->x < g_midX && ball.vx < 0);
-    
-    if (!ball_coming) {
-        // Volver al centro cuando la pelota no viene hacia nosotros
-        float center = (g_top + g_bottom) / 2.0f;
-        if (cpu_paddle->y < center - 1.0f) return 1;
-        if (cpu_paddle->y > center + 1.0f) return -1;
-        return 0;
-    }
-    
-    // Agregar margen de error aleatorio para hacer la CPU más humana
-    float target_y = ball.y;
-    if (rand() % 100 < 30) { // 30% de chance de error
-        target_y += ((rand() % 2) ? 1 : -1) * CPU_ERROR_MARGIN;
+static void tourney_account(const CpuConfig* cfgs, TourneyStanding* st, const TourneyGame* games,
+                            long n, FILE* out, time_t ts) {
+    for (long i = 0; i < n; ++i) {
+        const TourneyGame* g = &games[i];
+        TourneyStanding* A = &st[g->a];
+        TourneyStanding* B = &st[g->b];
+        if (g->capped) { A->capped++; B->capped++; continue; }
+        const bool a_won = g->s1 > g->s2;
+        double sa = a_won ? 1.0 : 0.0;
+        double ea = 1.0 / (1.0 + pow(10.0, (B->elo - A->elo) / 400.0));
+        A->elo += TOURNEY_ELO_K * (sa - ea);
+        B->elo -= TOURNEY_ELO_K * (sa - ea);
+        if (a_won) { A->wins++;  B->losses++; }
+        else       { A->losses++; B->wins++; }
+
+        if (out) {
+            Entry e;
+            snprintf(e.winner, sizeof(e.winner), "%s", cfgs[a_won ? g->a : g->b].name);
+            snprintf(e.loser,  sizeof(e.loser),  "%s", cfgs[a_won ? g->b : g->a].name);
+            e.winScore  = a_won ? g->s1 : g->s2;
+            e.loseScore = a_won ? g->s2 : g->s1;
+            e.ts = ts;
+            fprintf(out, "%s,%s,%d,%d,%ld\n", e.winner, e.loser, e.winScore, e.loseScore, (long)e.ts);
+        }
     }
-    
-    // Decidir dirección
-    float diff = target_y - cpu_paddle->y;
-    if (diff < -0.5f) return -1;
-    if (diff > 0.5f) return 1;
-    return 0;
 }
 
-/** @brief Hilo de la bola: integra posición, rebotes, colisiones y puntaje.
- *  @note Protege todo el update con g_lock. Ajusta time_ball.
+/** @brief Suizo: empareja vecinos de la tabla (puntos, Elo) evitando revanchas si se puede.
+ *  @param met matriz n x n de series ya jugadas. @return parejas escritas en pairs.
  */
-static void* thread_ball_func(void* arg) {
-    (void)arg;
-    while (g_threads_should_run) {
-        auto start = high_resolution_clock::now();
-        if (!g_paused) {
-            pthread_mutex_lock(&g_lock);
-            g_ball.x += g_ball.vx;
-            g_ball.y += g_ball.vy;
-            
-            // --- Rebote vertical en techo y piso ---
-            if (g_ball.y <= g_top + 1) { 
-                g_ball.y = g_top + 1; 
-                g_ball.vy *= -1.0f; 
-            }
-            if (g_ball.y >= g_bottom - 1) { 
-                g_ball.y = g_bottom - 1; 
-                g_ball.vy *= -1.0f; 
-            }
-            
-            // --- Colisión con paleta izquierda (solo si la bola viene hacia la izquierda) ---
-            int y1 = (int)g_pad1.y;
-            if ((int)g_ball.x == g_pad1.x + 1 && g_ball.vx < 0) {
-                if ((int)g_ball.y >= y1 - PADDLE_LEN/2 && (int)g_ball.y <= y1 + PADDLE_LEN/2) {
-                    g_ball.vx *= -1.0f;
-                    int dy = (int)g_ball.y - y1;
-                    g_ball.vy += 0.15f * dy;
-                }
-            }
-            
-            // --- Colisión con paleta derecha (solo si la bola viene hacia la derecha) ---
-            int y2 = (int)g_pad2.y;
-            if ((int)g_ball.x == g_pad2.x - 1 && g_ball.vx > 0) {
-                if ((int)g_ball.y >= y2 - PADDLE_LEN/2 && (int)g_ball.y <= y2 + PADDLE_LEN/2) {
-                    g_ball.vx *= -1.0f;
-                    int dy = (int)g_ball.y - y2;
-                    g_ball.vy += 0.15f * dy;
-                }
-            }
-            
-            // --- Detección de gol: reinicia bola y suma puntaje ---
-            if ((int)g_ball.x <= g_left) {
-                g_score.p2++;
-                ball_spawn_random(true);   // sirve hacia la derecha
-            } else if ((int)g_ball.x >= g_right) {
-                g_score.p1++;
-                ball_spawn_random(false);  // sirve hacia la izquierda
-            }
-
-            pthread_mutex_unlock(&g_lock);
+static int tourney_swiss_pairs(int n, const TourneyStanding* st, const bool* met, int (*pairs)[2]) {
+    int order[64];
+    for (int i = 0; i < n; ++i) order[i] = i;
+    std::sort(order, order + n, [&](int x, int y) {
+        if (st[x].points != st[y].points) return st[x].points > st[y].points;
+        if (st[x].elo != st[y].elo) return st[x].elo > st[y].elo;
+        return x < y;
+    });
+    bool used[64] = { false };
+    int np = 0;
+    for (int i = 0; i < n; ++i) {
+        int a = order[i];
+        if (used[a]) continue;
+        int pick = -1;
+        for (int j = i + 1; j < n; ++j) {
+            int b = order[j];
+            if (used[b]) continue;
+            if (pick < 0) pick = b;                        // si todos son revancha, el más cercano
+            if (!met[a * n + b]) { pick = b; break; }
         }
-        auto end = high_resolution_clock::now();
-        time_ball += (end - start);
-        usleep(FRAME_USEC_PLAY);
+        if (pick < 0) break;                               // impar: a queda libre esta ronda
+        used[a] = used[pick] = true;
+        pairs[np][0] = a;
+        pairs[np][1] = pick;
+        np++;
     }
-    return NULL;
+    return np;
 }
 
-/** @brief Integra movimiento suave de paleta con aceleración, fricción y clamping.
- *  @param input_dir -1 arriba, 0 neutro, +1 abajo.
+/** @brief Corre el torneo y muestra la tabla final ordenada por Elo.
+ *  @param games_per_pair partidas por serie (se alternan los lados).
+ *  @param rounds rondas del suizo (<= 0: log2(configs) + 2).
  */
-static void move_paddle(Paddle* p, int input_dir) {
-    p->vy += input_dir * PADDLE_ACC * PADDLE_DT;
+static int run_tournament(TourneyFormat format, int games_per_pair, int rounds, int n_threads,
+                          const char* out_path) {
+    CpuConfig cfgs[64];
+    const int n = tourney_make_configs(cfgs);
+    TourneyStanding st[64];
+    for (int i = 0; i < n; ++i) {
+        st[i].wins = st[i].losses = st[i].capped = 0;
+        st[i].elo = TOURNEY_ELO_START;
+        st[i].points = 0.0;
+    }
+    if (games_per_pair < 1) games_per_pair = 1;
+    if (n_threads < 1) n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+    if (rounds <= 0) { rounds = 2; for (int k = 1; k < n; k <<= 1) rounds++; }
+    if (format == TOURNEY_ROUND_ROBIN) rounds = 1;
+
+    FILE* out = out_path ? fopen(out_path, "w") : NULL;
+    if (out_path && !out) fprintf(stderr, "No se pudo abrir %s; se omite la salida por partida\n", out_path);
+    const time_t ts = time(NULL);
+
+    const int max_pairs = n * (n - 1) / 2;
+    int (*pairs)[2] = (int (*)[2])malloc(sizeof(int[2]) * (size_t)max_pairs);
+    TourneyGame* games = (TourneyGame*)malloc(sizeof(TourneyGame) * (size_t)max_pairs * games_per_pair);
+    bool* met = (bool*)calloc((size_t)n * n, sizeof(bool));
+    if (!pairs || !games || !met) {
+        free(pairs); free(games); free(met);
+        if (out) fclose(out);
+        fprintf(stderr, "Sin memoria para el torneo\n");
+        return 1;
+    }
 
-    // Acelera según input; aplica fricción cuando no hay input.
-    if (input_dir == 0) {
-        if (p->vy > 0) {
-            p->vy -= PADDLE_FRICTION * PADDLE_DT;
-            if (p->vy < 0) p->vy = 0;
-        } else if (p->vy < 0) {
-            p->vy += PADDLE_FRICTION * PADDLE_DT;
-            if (p->vy > 0) p->vy = 0;
+    long long total_games = 0, total_ticks = 0, total_capped = 0, steals = 0;
+    const int64_t t0 = mono_ns();
+    for (int r = 0; r < rounds; ++r) {
+        int np = 0;
+        if (format == TOURNEY_ROUND_ROBIN) {
+            for (int a = 0; a < n; ++a)
+                for (int b = a + 1; b < n; ++b) { pairs[np][0] = a; pairs[np][1] = b; np++; }
+        } else {
+            np = tourney_swiss_pairs(n, st, met, pairs);
         }
+        // Orden partida-mayor: la k-ésima partida de todas las series antes de la k+1-ésima,
+        // así el Elo secuencial no ve una serie entera de golpe.
+        const long n_games = (long)np * games_per_pair;
+        for (long i = 0; i < n_games; ++i) {
+            const int* p = pairs[i % np];
+            const bool swap = (i / np) & 1;
+            games[i].a = swap ? p[1] : p[0];
+            games[i].b = swap ? p[0] : p[1];
+        }
+        TourneyBatch batch = { cfgs, games, match_seed(g_seed, (uint64_t)r) };
+        long long round_steals = 0;
+        ws_run(n_games, n_threads, tourney_play, &batch, &round_steals);
+        steals += round_steals;
+
+        tourney_account(cfgs, st, games, n_games, out, ts);
+        for (int k = 0; k < np; ++k) {
+            int a = pairs[k][0], b = pairs[k][1], wa = 0, wb = 0;
+            for (long i = k; i < n_games; i += np) {
+                const TourneyGame* g = &games[i];
+                if (g->capped) continue;
+                int s_a = g->a == a ? g->s1 : g->s2, s_b = g->a == a ? g->s2 : g->s1;
+                if (s_a > s_b) wa++; else if (s_b > s_a) wb++;
+            }
+            st[a].points += wa > wb ? 1.0 : wa == wb ? 0.5 : 0.0;
+            st[b].points += wb > wa ? 1.0 : wa == wb ? 0.5 : 0.0;
+            met[a * n + b] = met[b * n + a] = true;
+        }
+        for (long i = 0; i < n_games; ++i) {
+            total_ticks  += games[i].ticks;
+            total_capped += games[i].capped;
+        }
+        total_games += n_games;
     }
+    const double secs = (mono_ns() - t0) / 1e9;
+    if (out) fclose(out);
+
+    int order[64];
+    for (int i = 0; i < n; ++i) order[i] = i;
+    std::sort(order, order + n, [&](int x, int y) { return st[x].elo > st[y].elo; });
+
+    printf("--- TORNEO %s ---\n", format == TOURNEY_ROUND_ROBIN ? "TODOS CONTRA TODOS" : "SUIZO");
+    printf("Configuraciones: %d, rondas: %d, partidas por serie: %d, hilos: %d\n",
+           n, rounds, games_per_pair, n_threads);
+    printf("Semilla: %llu\n", (unsigned long long)g_seed);
+    printf("%3s %-18s %5s %6s %4s %-6s %6s %6s %6s %7s %5s %8s\n",
+           "#", "Config", "Reacc", "Error", "%err", "Estrat", "G", "P", "Tope", "%Vict", "Pts", "Elo");
+    for (int k = 0; k < n; ++k) {
+        const int i = order[k];
+        const int played = st[i].wins + st[i].losses;
+        printf("%3d %-18s %5d %6.1f %4d %-6s %6d %6d %6d %6.1f%% %5.1f %8.1f\n", k + 1, cfgs[i].name,
+               cfgs[i].reaction_delay, (double)cfgs[i].error_margin, cfgs[i].error_pct,
+               CPU_STRAT_NAME[cfgs[i].strategy], st[i].wins, st[i].losses, st[i].capped,
+               played ? 100.0 * st[i].wins / played : 0.0, st[i].points, st[i].elo);
+    }
+    printf("Partidas: %lld, ticks: %lld, tiempo: %.3f s (%.0f partidas/s, %.0f ticks/s), robos: %lld\n",
+           total_games, total_ticks, secs, secs > 0 ? total_games / secs : 0.0,
+           secs > 0 ? total_ticks / secs : 0.0, steals);
+    printf("Cortadas por el tope de %ld ticks (fuera de Elo y tabla): %lld (%.1f%%)\n", HEADLESS_MAX_TICKS,
+           total_capped, total_games ? 100.0 * total_capped / total_games : 0.0);
+    if (out) printf("Resultados por partida (formato de %s): %s\n", LEADERBOARD_FILE, out_path);
+
+    free(pairs);
+    free(games);
+    free(met);
+    return 0;
+}
 
-    // Limita velocidad máxima para evitar “teletransportes”.
-    if (p->vy > PADDLE_MAX_V)  p->vy = PADDLE_MAX_V;
-    if (p->vy < -PADDLE_MAX_V) p->vy = -PADDLE_MAX_V;
+// ===== Calibración de dificultad (--calibrate) =====
+// Busca, para cada nivel de DIFFICULTY_TARGETS, una CpuConfig cuya tasa de victorias
+// contra CPU_DEFAULT_CONFIG (bot de referencia) se acerque al objetivo. Estrategia
+// evolutiva (mu/lambda) sobre (retardo, error, %err) normalizados a [0,1]: la media se
+// mueve hacia los mejores mu con pesos logarítmicos y sigma se agranda si la generación
+// mejoró el mejor resultado y se achica si no. Los candidatos de una generación juegan
+// con las mismas semillas (números aleatorios comunes) para comparar sin ruido extra.
+// Todas las partidas de una generación van juntas al pool de robo de trabajo.
+// El mejor de cada generación se re-evalúa con otras semillas antes de compararlo con el
+// mejor histórico: elegir por la misma muestra que ordenó sobreestima al ganador. Aun así
+// el mínimo de esas re-evaluaciones es optimista, así que el ganador se ajusta al final:
+// con retardo y %err fijos la tasa baja monótonamente con el margen de error (continuo;
+// %err es entero y un punto puede mover la tasa 0.2), y una bisección sobre el margen
+// (todas sus partidas con las mismas semillas) busca el cruce con el objetivo.
+// Los niveles se buscan de más fácil a más difícil y cada uno queda dentro de la caja
+// del anterior (retardo, error y %err no mayores), así la escalera es monótona.
+// Al final cada nivel se verifica con semillas nuevas; si alguno queda a más de
+// CALIB_MAX_SE errores estándar del objetivo no se emite la tabla.
+// La salida es la tabla DIFFICULTY_PRESETS lista para pegar en este archivo.
+
+#define CALIB_LAMBDA      16     // candidatos por generación
+#define CALIB_MU          4      // padres
+#define CALIB_GENERATIONS 12
+#define CALIB_GAMES       64     // partidas por candidato (mitad de cada lado)
+#define CALIB_CHECK_GAMES 512    // re-evaluación del mejor de cada generación
+#define CALIB_BISECT_GAMES 2048  // partidas por paso de la bisección del margen
+#define CALIB_BISECT_STEPS 13    // 6 filas / 2^13 < 0.001 (resolución del margen en la tabla)
+#define CALIB_FINAL_GAMES 1024   // verificación final, con otras semillas
+#define CALIB_MAX_SE      2.0    // tolerancia de la verificación, en errores estándar
+#define CALIB_SIGMA0      0.30
+#define CALIB_DELAY_MAX   12
+#define CALIB_MARGIN_MAX  6.0f
 
-    p->y += p->vy * PADDLE_DT;
+typedef struct {
+    const char* name;
+    double      target;   // tasa de victorias buscada contra la referencia
+} DifficultyTarget;
+
+// En orden de dificultad creciente (la búsqueda acota cada nivel con el anterior).
+static const DifficultyTarget DIFFICULTY_TARGETS[] = {
+    { "facil",   0.15 },
+    { "normal",  0.35 },
+    { "dificil", 0.50 },
+    { "experto", 0.80 },
+};
 
-    // Integra posición y recorta contra límites del campo.
-    float minY = g_top + 1 + PADDLE_LEN/2;
-    float maxY = g_bottom - 1 - PADDLE_LEN/2;
-    if (p->y < minY) { p->y = minY; p->vy = 0; }
-    if (p->y > maxY) { p->y = maxY; p->vy = 0; }
+typedef struct {
+    const CpuConfig* cands;
+    int              games;      // partidas por candidato
+    uint64_t         seed_base;
+    double*          score;      // puntos del candidato por partida (1, 0.5, 0)
+} CalibBatch;
+
+/** @brief Normal estándar (Box-Muller) a partir del Rng. */
+static double rng_gauss(Rng* r) {
+    double u1 = (rng_next(r) + 0.5) / 4294967296.0;
+    double u2 = (rng_next(r) + 0.5) / 4294967296.0;
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
 }
 
-/** @brief Hilo de paleta 1: lee input/IA y actualiza posición. */
-static void* thread_p1_func(void* arg) {
-    (void)arg;
-    while (g_threads_should_run) {
-         auto start = high_resolution_clock::now();
-    
-        if (!g_paused) {
-            pthread_mutex_lock(&g_lock);
-            int dir = 0;
-            if (g_game_mode == MODE_CVC) {
-                // CPU controla paleta 1
-                g_cpu1_delay_counter++;
-                if (g_cpu1_delay_counter >= CPU_REACTION_DELAY) {
-                    dir = cpu_calculate_direction(&g_pad1, g_ball);
-                    g_cpu1_delay_counter = 0;
-                }
-            } else {
-                if (g_p1_hold_up   > 0 && g_p1_hold_down == 0) dir = -1;
-                else if (g_p1_hold_down > 0 && g_p1_hold_up == 0) dir = +1;
-                else dir = 0;
-            }
-            // update_paddle(...) si usas modelo suave; o move_paddle(...) si usas step fijo
-            move_paddle(&g_pad1, dir);
-            pthread_mutex_unlock(&g_lock);
-        }
-        auto end = high_resolution_clock::now();
-        time_p1 += (end - start);
-        usleep(FRAME_USEC_PLAY);
+/** @brief Convierte un punto de [0,1]^3 en CpuConfig (estrategia de predicción exacta). */
+static void calib_decode(const double* x, CpuConfig* c, const char* name) {
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    c->reaction_delay = 1 + (int)lround(x[0] * (CALIB_DELAY_MAX - 1));
+    c->error_margin   = (float)(lround(x[1] * CALIB_MARGIN_MAX * 1000.0) / 1000.0);   // lo que imprime la tabla
+    c->error_pct      = (int)lround(x[2] * 100.0);
+    c->strategy       = CPU_STRAT_PREDICT;
+}
+
+/** @brief Tarea del pool: partida i = candidato i / games contra la referencia. */
+static void calib_play(void* ctx, long i) {
+    CalibBatch* b = (CalibBatch*)ctx;
+    const long cand = i / b->games, game = i % b->games;
+    const bool cand_left = (game & 1) == 0;
+    Match m;
+    // Misma semilla para la partida k de todos los candidatos.
+    match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(b->seed_base, (uint64_t)game));
+    m.cpu1.cfg = cand_left ? &b->cands[cand] : &CPU_DEFAULT_CONFIG;
+    m.cpu2.cfg = cand_left ? &CPU_DEFAULT_CONFIG : &b->cands[cand];
+    // Partida completa hasta SCORE_TO_WIN, como en el juego; HEADLESS_MAX_TICKS es solo
+    // un tope de seguridad (si se alcanza, cuenta el marcador parcial).
+    while (!match_finished(&m) && m.ticks < HEADLESS_MAX_TICKS) {
+        int dir1 = match_cpu_dir(&m, 1);
+        int dir2 = match_cpu_dir(&m, 2);
+        match_step(&m, dir1, dir2);
     }
-    return NULL;
+    const int mine = cand_left ? m.score.p1 : m.score.p2;
+    const int theirs = cand_left ? m.score.p2 : m.score.p1;
+    b->score[i] = mine > theirs ? 1.0 : mine < theirs ? 0.0 : 0.5;
 }
 
-/** @brief Hilo de paleta 2: lee input/IA y actualiza posición. */
-static void* thread_p2_func(void* arg) {
-    (void)arg;
-    while (g_threads_should_run) {
-        auto start = high_resolution_clock::now();
-        if (!g_paused) {
-            pthread_mutex_lock(&g_lock);
-            int dir = 0;
-            if (g_game_mode == MODE_PVC || g_game_mode == MODE_CVC) {
-                // CPU controla paleta 2
-                g_cpu2_delay_counter++;
-                if (g_cpu2_delay_counter >= CPU_REACTION_DELAY) {
-                    dir = cpu_calculate_direction(&g_pad2, g_ball);
-                    g_cpu2_delay_counter = 0;
-                }
+/** @brief Tasa de victorias de cada candidato contra la referencia (una corrida del pool). */
+static void calib_evaluate(const CpuConfig* cands, int n, int games, uint64_t seed_base,
+                           int n_threads, double* winrate, long long* n_games) {
+    double* score = (double*)malloc(sizeof(double) * (size_t)n * games);
+    if (!score) { for (int c = 0; c < n; ++c) winrate[c] = 0.0; return; }
+    CalibBatch b = { cands, games, seed_base, score };
+    ws_run((long)n * games, n_threads, calib_play, &b, NULL);
+    for (int c = 0; c < n; ++c) {
+        double sum = 0.0;
+        for (int g = 0; g < games; ++g) sum += score[(long)c * games + g];
+        winrate[c] = sum / games;
+    }
+    *n_games += (long long)n * games;
+    free(score);
+}
+
+/** @brief Corre la búsqueda para cada nivel y escribe la tabla generada.
+ *  @param out_path archivo de salida (NULL: stdout).
+ */
+static int run_calibration(int n_threads, const char* out_path) {
+    if (n_threads < 1) n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+    const int n_levels = (int)(sizeof(DIFFICULTY_TARGETS) / sizeof(DIFFICULTY_TARGETS[0]));
+    CpuConfig best_cfg[8];
+    double    best_wr[8];
+    long long n_games = 0;
+    const int64_t t0 = mono_ns();
+
+    double logw[CALIB_MU], wsum = 0.0;
+    for (int k = 0; k < CALIB_MU; ++k) { logw[k] = log(CALIB_MU + 0.5) - log(k + 1.0); wsum += logw[k]; }
+
+    double hi[3] = { 1.0, 1.0, 1.0 };   // caja del nivel: no más débil que el anterior
+    bool   all_ok = true;
+    for (int lv = 0; lv < n_levels; ++lv) {
+        const DifficultyTarget* tgt = &DIFFICULTY_TARGETS[lv];
+        Rng rng;
+        rng_seed(&rng, match_seed(g_seed, 1000 + (uint64_t)lv));
+        double mean[3], best_x[3];
+        for (int d = 0; d < 3; ++d) mean[d] = best_x[d] = 0.5 * hi[d];
+        double sigma = CALIB_SIGMA0, best_err = 2.0;
+
+        for (int gen = 0; gen < CALIB_GENERATIONS; ++gen) {
+            double    x[CALIB_LAMBDA][3];
+            CpuConfig cands[CALIB_LAMBDA];
+            double    wr[CALIB_LAMBDA];
+            for (int c = 0; c < CALIB_LAMBDA; ++c) {
+                for (int d = 0; d < 3; ++d) x[c][d] = std::clamp(mean[d] + sigma * rng_gauss(&rng), 0.0, hi[d]);
+                calib_decode(x[c], &cands[c], tgt->name);
+            }
+            calib_evaluate(cands, CALIB_LAMBDA, CALIB_GAMES, match_seed(g_seed, (uint64_t)(lv * 1000 + gen)),
+                           n_threads, wr, &n_games);
+
+            int order[CALIB_LAMBDA];
+            for (int c = 0; c < CALIB_LAMBDA; ++c) order[c] = c;
+            std::sort(order, order + CALIB_LAMBDA, [&](int a, int b) {
+                return fabs(wr[a] - tgt->target) < fabs(wr[b] - tgt->target);
+            });
+            for (int d = 0; d < 3; ++d) {
+                double m = 0.0;
+                for (int k = 0; k < CALIB_MU; ++k) m += logw[k] * x[order[k]][d];
+                mean[d] = m / wsum;
+            }
+            double check_wr;
+            calib_evaluate(&cands[order[0]], 1, CALIB_CHECK_GAMES,
+                           match_seed(g_seed, (uint64_t)(500000 + lv * 1000 + gen)), n_threads, &check_wr, &n_games);
+            const double err = fabs(check_wr - tgt->target);
+            if (err < best_err) {
+                best_err = err;
+                for (int d = 0; d < 3; ++d) best_x[d] = x[order[0]][d];
+                sigma *= 1.2;
             } else {
-                if (g_p2_hold_up   > 0 && g_p2_hold_down == 0) dir = -1;
-                else if (g_p2_hold_down > 0 && g_p2_hold_up == 0) dir = +1;
-                else dir = 0;
+                sigma *= 0.8;
             }
-            move_paddle(&g_pad2, dir);
-            pthread_mutex_unlock(&g_lock);
+            fprintf(stderr, "%-8s gen %2d  sigma %.3f  mejor |error| %.3f\n", tgt->name, gen, sigma, best_err);
         }
-        auto end = high_resolution_clock::now();
-        time_p2 += (end - start);
-        usleep(FRAME_USEC_PLAY);
+
+        // Bisección del margen dentro de la caja: lo = más fuerte, hi = más débil.
+        const uint64_t bisect_seed = match_seed(g_seed, 888888 + (uint64_t)lv);
+        double lo = 0.0, hi_m = hi[1], probe_x[3] = { best_x[0], best_x[1], best_x[2] };
+        double best_probe_err = 2.0;
+        for (int step = 0; step <= CALIB_BISECT_STEPS; ++step) {
+            CpuConfig probe;
+            double wr;
+            calib_decode(probe_x, &probe, tgt->name);
+            calib_evaluate(&probe, 1, CALIB_BISECT_GAMES, bisect_seed, n_threads, &wr, &n_games);
+            if (fabs(wr - tgt->target) < best_probe_err) {
+                best_probe_err = fabs(wr - tgt->target);
+                best_x[1] = probe_x[1];
+            }
+            fprintf(stderr, "%-8s margen %.3f  tasa %.3f\n", tgt->name, (double)probe.error_margin, wr);
+            if (wr > tgt->target) lo = probe_x[1];   // demasiado fuerte: más margen
+            else hi_m = probe_x[1];
+            probe_x[1] = 0.5 * (lo + hi_m);
+        }
+
+        calib_decode(best_x, &best_cfg[lv], tgt->name);
+        calib_evaluate(&best_cfg[lv], 1, CALIB_FINAL_GAMES, match_seed(g_seed, 999999 + (uint64_t)lv),
+                       n_threads, &best_wr[lv], &n_games);
+        const double se = sqrt(tgt->target * (1.0 - tgt->target) / CALIB_FINAL_GAMES);
+        if (fabs(best_wr[lv] - tgt->target) > CALIB_MAX_SE * se) {
+            fprintf(stderr, "%s: tasa %.3f fuera de %.2f +- %.3f\n", tgt->name, best_wr[lv], tgt->target,
+                    CALIB_MAX_SE * se);
+            all_ok = false;
+        }
+        for (int d = 0; d < 3; ++d) hi[d] = best_x[d];
+    }
+    const double secs = (mono_ns() - t0) / 1e9;
+    fprintf(stderr, "Partidas: %lld en %.2f s (%.0f partidas/s, %d hilos)\n",
+            n_games, secs, secs > 0 ? n_games / secs : 0.0, n_threads);
+    if (!all_ok) {
+        fprintf(stderr, "Calibración fallida: no se emite la tabla (probar otra --seed)\n");
+        return 1;
     }
-    return NULL;
-}
 
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "No se pudo abrir %s\n", out_path);
+        return 1;
+    }
+    fprintf(out, "// Generado por: pong --calibrate --seed %llu (%d generaciones x %d candidatos x %d partidas).\n",
+            (unsigned long long)g_seed, CALIB_GENERATIONS, CALIB_LAMBDA, CALIB_GAMES);
+    fprintf(out, "// Última columna: tasa de victorias contra CPU_DEFAULT_CONFIG en %d partidas (objetivo),\n"
+                 "// dentro de %.0f errores estándar; ningún nivel tiene más retardo ni error que el anterior.\n",
+            CALIB_FINAL_GAMES, CALIB_MAX_SE);
+    fprintf(out, "static const CpuConfig DIFFICULTY_PRESETS[] = {\n");
+    for (int lv = 0; lv < n_levels; ++lv) {
+        const CpuConfig* c = &best_cfg[lv];
+        char name[NAME_MAXLEN + 4];
+        snprintf(name, sizeof(name), "\"%.*s\",", NAME_MAXLEN, c->name);
+        fprintf(out, "    { %-10s %2d, %.3ff, %3d, CPU_STRAT_PREDICT },   // %.3f (%.2f)\n", name,
+                c->reaction_delay, (double)c->error_margin, c->error_pct, best_wr[lv],
+                DIFFICULTY_TARGETS[lv].target);
+    }
+    fprintf(out, "};\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
 
 /** @brief Pantalla de pedido de nombre (JvC). Bloqueante. */
 static void input_names_screen() {
@@ -793,52 +4272,103 @@ static void instructions_screen() {
     }
 }
 
-/** @brief Lista el Top N del leaderboard. ENTER para volver. */
+/** @brief Lista el Top N del leaderboard. TAB alterna partidas/jugadores; ENTER para volver. */
 static void leaderboard_screen() {
     nodelay(stdscr, FALSE);
     keypad(stdscr, TRUE);
-    Entry entries[MAX_LEADER_ENTRIES];
-    int n = load_entries(entries, MAX_LEADER_ENTRIES);
-    qsort(entries, n, sizeof(Entry), cmp_entry);
+    const int64_t t_load = mono_ns();
+    lb_writer_flush();   // que el Top incluya las partidas recién encoladas
+    Entry entries[LEADERBOARD_TOP];
+    int n;
+    LbView view;
+    if (lb_view_open(&view)) {
+        n = lb_view_top(&view, entries, LEADERBOARD_TOP);
+        lb_view_close(&view);
+    } else {
+        // Sin store binario (p.ej. directorio de solo lectura): top-K sobre todo el CSV.
+        n = load_top_entries(entries, LEADERBOARD_TOP);
+    }
+    trace_span(&g_tr_main, "leaderboard carga", t_load, mono_ns());
+
+    int topN = (n < LEADERBOARD_TOP) ? n : LEADERBOARD_TOP;
 
-    int topN = (n < 10) ? n : 10;
+    static const char* sort_names[PSORT_COUNT] = { "victorias", "% victorias", "diferencia", "racha" };
+    bool show_players = false;
+    PlayerSort sort = PSORT_WINS;
+    PlayerStat players[LEADERBOARD_TOP];
+    int np = -1;   // -1: sin cargar / sin estadísticas
 
     while (1) {
         clear();
-        mvprintw(0, 2, "PUNTAJES DESTACADOS (Top %d)  -  ENTER para volver", topN);
-        mvprintw(2, 2, "%-3s %-24s %-6s %-24s %-10s", "#", "Ganador", "Marcador", "Perdedor", "Fecha");
-        mvhline(3, 2, '-', 70);
-        for (int i = 0; i < topN; ++i) {
-            char datebuf[20];
-            struct tm* tmv = localtime(&entries[i].ts);
-            strftime(datebuf, sizeof(datebuf), "%Y-%m-%d", tmv);
-            mvprintw(4 + i, 2, "%-3d %-24s %2d-%-3d %-24s %-10s",
-                     i+1, entries[i].winner, entries[i].winScore, entries[i].loseScore, entries[i].loser, datebuf);
+        if (!show_players) {
+            mvprintw(0, 2, "PUNTAJES DESTACADOS (Top %d)  -  TAB jugadores, ENTER para volver", topN);
+            mvprintw(2, 2, "%-3s %-24s %-6s %-24s %-10s", "#", "Ganador", "Marcador", "Perdedor", "Fecha");
+            mvhline(3, 2, '-', 70);
+            for (int i = 0; i < topN; ++i) {
+                char datebuf[20];
+                struct tm* tmv = localtime(&entries[i].ts);
+                strftime(datebuf, sizeof(datebuf), "%Y-%m-%d", tmv);
+                mvprintw(4 + i, 2, "%-3d %-24s %2d-%-3d %-24s %-10s",
+                         i+1, entries[i].winner, entries[i].winScore, entries[i].loseScore, entries[i].loser, datebuf);
+            }
+            if (n == 0) mvprintw(5, 2, "Aun no hay partidas registradas. Juega una y se guardara aqui.");
+        } else {
+            if (np < 0) np = players_top(players, LEADERBOARD_TOP, sort);
+            mvprintw(0, 2, "JUGADORES por %s  -  1-4 ordenar, TAB partidas, ENTER para volver",
+                     sort_names[sort]);
+            mvprintw(2, 2, "%-3s %-24s %5s %5s %6s %6s %5s %-10s",
+                     "#", "Jugador", "G", "P", "%G", "Dif", "Racha", "Ultima");
+            mvhline(3, 2, '-', 76);
+            for (int i = 0; i < np; ++i) {
+                const PlayerStat* ps = &players[i];
+                int total = ps->wins + ps->losses;
+                char datebuf[20];
+                time_t last = (time_t)ps->last_played;
+                strftime(datebuf, sizeof(datebuf), "%Y-%m-%d", localtime(&last));
+                mvprintw(4 + i, 2, "%-3d %-24s %5d %5d %5.1f%% %+6lld %5d %-10s",
+                         i+1, ps->name, ps->wins, ps->losses,
+                         total ? 100.0 * ps->wins / total : 0.0,
+                         (long long)(ps->points_for - ps->points_against), ps->best_streak, datebuf);
+            }
+            if (np <= 0) mvprintw(5, 2, "Aun no hay estadisticas de jugadores.");
         }
-        if (n == 0) mvprintw(5, 2, "Aun no hay partidas registradas. Juega una y se guardara aqui.");
         refresh();
         int ch = getch();
         if (ch == '\n' || ch == KEY_ENTER) break;
+        if (ch == '\t') show_players = !show_players;
+        if (show_players && ch >= '1' && ch < '1' + PSORT_COUNT) {
+            sort = (PlayerSort)(ch - '1');
+            np = -1;
+        }
     }
 }
 
 /** @brief Anuncia ganador y muestra atajos para reiniciar o volver a menú. */
 static void announce_winner_and_wait(const char* who) {
+    const char* msg = "(ENTER) Reiniciar   (Q) Menu";
+    if (g_render_backend == RENDER_ANSI) {
+        // Encima del último frame (g_fb.cur lo conserva): un refresh() de ncurses
+        // repintaría stdscr sobre lo que escribió el backend ANSI.
+        const int cx = g_fb.cols/2, cy = g_fb.rows/2;
+        ansi_fb_print(&g_fb, cy - 1, cx - (int)strlen(who)/2, who, 0, true);
+        ansi_fb_print(&g_fb, cy + 1, cx - (int)strlen(msg)/2, msg, 0, false);
+        ansi_fb_present(&g_fb);
+        return;
+    }
     int H, W; getmaxyx(stdscr, H, W);
     int cx = W/2;
     attron(A_BOLD);
     mvprintw((H/2)-1, cx - (int)strlen(who)/2, "%s", who);
     attroff(A_BOLD);
-    const char* msg = "(ENTER) Reiniciar   (Q) Menu";
     mvprintw((H/2)+1, cx - (int)strlen(msg)/2, "%s", msg);
     refresh();
 }
 
 /** @brief Loop principal de juego: entrada, render por capas y fin de partida.
  *  @details
- *   - Lanza hilos de bola/paletas.
+ *   - Lanza el hilo de simulación (paso fijo: paleta 1, paleta 2, bola).
  *   - Lee teclado no bloqueante.
- *   - Render: borra dinámica, redibuja cancha/HUD/sprites y compone con doupdate().
+ *   - Render incremental: solo las celdas que cambiaron desde el frame anterior.
  *   - Condición de victoria -> guarda Entry y espera acción del usuario.
  */
 static Scene play_screen() {
@@ -846,136 +4376,449 @@ static Scene play_screen() {
     keypad(stdscr, TRUE);
     timeout(0);
     reset_world();
+    snapshot_reset();
+    g_lat_shown = g_input_applied;
+    memset(g_lat_closed, 0, sizeof(g_lat_closed));
+    replay_rec_start();
+    if (g_render_backend == RENDER_ANSI && !g_fb.cur) {
+        int H, W; getmaxyx(stdscr, H, W);
+        if (!ansi_fb_init(&g_fb, STDOUT_FILENO, H, W)) {
+            ansi_fb_free(&g_fb);
+            g_render_backend = RENDER_CURSES;
+        }
+    }
     versus_screen();
+    g_p1_hold_up = g_p1_hold_down = g_p2_hold_up = g_p2_hold_down = 0;
     g_threads_should_run = true;
-    pthread_create(&th_ball, NULL, thread_ball_func, NULL);
-    pthread_create(&th_p1, NULL, thread_p1_func, NULL);
-    pthread_create(&th_p2, NULL, thread_p2_func, NULL);
+    auto sim_start = high_resolution_clock::now();
+    pthread_create(&th_sim, NULL, thread_sim_func, NULL);
+    const bool input_ok = input_start();
 
     Scene next = SC_MENU;
-    while (!g_exit_requested) {
-        // reset “flags instantáneas”
-        g_p1_up = g_p1_down = g_p2_up = g_p2_down = 0;
-
-        int ch;
-        while ((ch = getch()) != ERR) {
-            switch (ch) {
-                case 'q': case 'Q': next = SC_MENU; goto END_PLAY;
-                case 'p': case 'P': g_paused = !g_paused; break;
-
-                // J1
-                case 'w': case 'W':
-                    g_p1_up = 1;
-                    g_p1_hold_up   = HOLD_FRAMES;
-                    g_p1_hold_down = 0;
-                    break;
-                case 's': case 'S':
-                    g_p1_down = 1;
-                    g_p1_hold_down = HOLD_FRAMES;
-                    g_p1_hold_up   = 0;
-                    break;
-
-                // J2
-                case KEY_UP:
-                    g_p2_up = 1;
-                    g_p2_hold_up   = HOLD_FRAMES;
-                    g_p2_hold_down = 0;
-                    break;
-                case KEY_DOWN:
-                    g_p2_down = 1;
-                    g_p2_hold_down = HOLD_FRAMES;
-                    g_p2_hold_up   = 0;
-                    break;
-            }
+    while (!g_exit_requested && input_ok) {
+        // Teclas de control (las de paleta las consume th_sim directamente)
+        InputEvent ev;
+        while (input_pop(&g_in_ctl, &ev)) {
+            if (ev.key == IN_QUIT) { next = SC_MENU; goto END_PLAY; }
+            if (ev.key == IN_PAUSE) g_paused = !g_paused;
         }
 
-        // “decay” por frame
-        if (g_p1_hold_up   > 0) g_p1_hold_up--;
-        if (g_p1_hold_down > 0) g_p1_hold_down--;
-        if (g_p2_hold_up   > 0) g_p2_hold_up--;
-        if (g_p2_hold_down > 0) g_p2_hold_down--;
-
-        // ===== RENDER POR CAPAS =====
+        // ===== RENDER INCREMENTAL =====
         // - g_win_static contiene bordes/centro (se dibuja 1 sola vez en reset_world()).
-        // - g_win_dynamic se borra cada frame y redibuja TODO lo visible para no tapar el estático.
-
-        auto start = high_resolution_clock::now();
-
-        pthread_mutex_lock(&g_lock);
-
-        // Limpia solo la ventana dinámica (no stdscr).
-        werase(g_win_dynamic);
-        // Redibuja el tablero aquí para que no quede “tapado” por el erase.
-        draw_borders_and_center_win(g_win_dynamic);
-        draw_score_win(g_win_dynamic);
-        draw_paddles_and_ball_win(g_win_dynamic);
-
-
-        if (g_paused) {
-            wattron(g_win_dynamic, A_BOLD);
-            mvwprintw(g_win_dynamic, (g_top + g_bottom)/2, g_midX - 2, "PAUSA");
-            wattroff(g_win_dynamic, A_BOLD);
-        }
-
-        // Composición eficiente: wnoutrefresh en ambas ventanas y un solo doupdate().
-        wnoutrefresh(g_win_dynamic);
-        wnoutrefresh(g_win_static);
-        doupdate();
-
-
-        pthread_mutex_unlock(&g_lock);
-
-        auto end = high_resolution_clock::now();
-        time_render += (end - start);
-
-
-        if (g_paused) {
-            attron(A_BOLD);
-            mvprintw((g_top + g_bottom)/2, g_midX - 2, "PAUSA");
-            attroff(A_BOLD);
+        // - g_win_dynamic se parchea solo donde algo cambió (render_dirty), sin werase.
+        // - Se dibuja desde la snapshot publicada: g_lock no se toma durante la E/S de terminal.
+
+        const int64_t render_start = mono_ns();
+
+        const WorldSnapshot* snap = snapshot_acquire();
+        int64_t t_out;
+        if (g_render_backend == RENDER_ANSI) {
+            ansi_draw_world(&g_fb, &g_match, snap);
+            t_out = mono_ns();
+            ansi_fb_present(&g_fb);
+        } else {
+            render_dirty(g_win_dynamic, snap);
+            wnoutrefresh(g_win_dynamic);
+            t_out = mono_ns();
+            doupdate();
         }
-
-        if (g_score.p1 >= SCORE_TO_WIN || g_score.p2 >= SCORE_TO_WIN) {
-            const bool p1win = g_score.p1 > g_score.p2;
+        const int64_t render_end = mono_ns();
+        hist_record(&g_hist_render, render_end - render_start);
+        trace_span(&g_tr_main, "frame", render_start, render_end);
+        trace_span(&g_tr_main, g_render_backend == RENDER_ANSI ? "write" : "doupdate", t_out, render_end);
+        latency_presented(snap);
+
+        // Ignora snapshots de la partida anterior (publicadas antes de un reinicio).
+        if (snap->gen == g_match_gen && score_is_final(&snap->score)) {
+            const Score final_score = snap->score;
+            const bool p1win = final_score.p1 > final_score.p2;
             const char* who = p1win ? "Gana JUGADOR 1" : "Gana JUGADOR 2";
             announce_winner_and_wait(who);
-            pthread_mutex_unlock(&g_lock);
 
             // Guardar en leaderboard
             Entry e = {0};
             strncpy(e.winner, p1win ? g_name1 : g_name2, NAME_MAXLEN);
             strncpy(e.loser,  p1win ? g_name2 : g_name1, NAME_MAXLEN);
-            e.winScore = p1win ? g_score.p1 : g_score.p2;
-            e.loseScore = p1win ? g_score.p2 : g_score.p1;
+            e.winScore = p1win ? final_score.p1 : final_score.p2;
+            e.loseScore = p1win ? final_score.p2 : final_score.p1;
             e.ts = time(NULL);
-            append_entry(&e);
-
-            nodelay(stdscr, FALSE);
-            int c;
-            while ((c = getch())) {
-                if (c == 'q' || c == 'Q') { next = SC_MENU; goto END_PLAY; }
-                if (c == '\n' || c == KEY_ENTER) {
-                    nodelay(stdscr, TRUE);
-                    reset_world();
-                    break;
+            lb_writer_submit(&e);
+
+            // Espera Enter (reiniciar) o Q (menú) desde la cola de control.
+            bool restart = false;
+            while (!restart) {
+                while (!restart && input_pop(&g_in_ctl, &ev)) {
+                    if (ev.key == IN_QUIT) { next = SC_MENU; goto END_PLAY; }
+                    restart = (ev.key == IN_ENTER);
                 }
+                if (!restart) usleep(FRAME_USEC_PLAY);
             }
+            // Con la partida terminada th_sim no avanza ni graba: la repetición se guarda
+            // sin lock. Bajo g_lock solo se reinicia el Match, en pausa hasta que la
+            // grabación y las ventanas nuevas (E/S de terminal, fuera del lock) estén listas;
+            // el store release de g_paused publica g_rec al acquire de th_sim.
+            replay_rec_save();
+            lock_timed(&g_lock, &g_ts_main);
+            reset_match();
+            g_paused = true;
+            unlock_timed(&g_lock, &g_ts_main);
+            replay_rec_start();
+            int H, W;
+            getmaxyx(stdscr, H, W);
+            create_field_windows(H, W);
+            g_paused.store(false, std::memory_order_release);
         }
         usleep(FRAME_USEC_PLAY);
     }
 
 END_PLAY:
+    if (input_ok) input_stop();
     g_threads_should_run = false;
-    usleep(2 * FRAME_USEC_PLAY);
-    pthread_join(th_ball, NULL);
-    pthread_join(th_p1, NULL);
-    pthread_join(th_p2, NULL);
+    pthread_join(th_sim, NULL);
+    time_sim_wall += high_resolution_clock::now() - sim_start;
+    replay_rec_save();
+    // ncurses no vio lo que escribió el backend ANSI: forzar repintado completo.
+    if (g_render_backend == RENDER_ANSI) clearok(curscr, TRUE);
     return next;
 }
 
+/** @brief Benchmark del backend ANSI: simula CVC y renderiza un frame por tick a stdout.
+ *  @details Pensado para redirigir stdout a un pipe o /dev/null; el reporte
+ *           (ns/frame, bytes y write() por frame) sale por stderr.
+ */
+static int run_render_bench(long n_frames) {
+    strncpy(g_name1, "CPU 1", NAME_MAXLEN);
+    strncpy(g_name2, "CPU 2", NAME_MAXLEN);
+
+    Match m;
+    uint64_t n_played = 0;
+    match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, n_played++));
+    AnsiFb fb;
+    if (!ansi_fb_init(&fb, STDOUT_FILENO, HEADLESS_LINES, HEADLESS_COLS)) {
+        ansi_fb_free(&fb);
+        fprintf(stderr, "Sin memoria para el framebuffer\n");
+        return 1;
+    }
+
+    WorldSnapshot snap;
+    auto start = high_resolution_clock::now();
+    for (long f = 0; f < n_frames; ++f) {
+        if (match_finished(&m) || m.ticks >= HEADLESS_MAX_TICKS) {
+            match_init(&m, HEADLESS_LINES, HEADLESS_COLS, match_seed(g_seed, n_played++));
+        }
+        int dir1 = match_cpu_dir(&m, 1);
+        int dir2 = match_cpu_dir(&m, 2);
+        match_step(&m, dir1, dir2);
+        snapshot_from_match(&snap, &m);
+        ansi_draw_world(&fb, &m, &snap);
+        ansi_fb_present(&fb);
+    }
+    auto end = high_resolution_clock::now();
+    double secs = duration<double>(end - start).count();
+
+    fprintf(stderr, "--- RENDER BENCH (ANSI) ---\n");
+    fprintf(stderr, "Frames: %lld (campo %dx%d)\n", fb.frames, HEADLESS_COLS, HEADLESS_LINES);
+    fprintf(stderr, "Tiempo: %.4f s (%.0f ns/frame)\n", secs,
+            fb.frames ? secs * 1e9 / fb.frames : 0.0);
+    fprintf(stderr, "Bytes: %lld (%.1f bytes/frame)\n", fb.bytes,
+            fb.frames ? (double)fb.bytes / fb.frames : 0.0);
+    fprintf(stderr, "write(): %lld (%.2f por frame)\n", fb.writes,
+            fb.frames ? (double)fb.writes / fb.frames : 0.0);
+    ansi_fb_free(&fb);
+    return 0;
+}
+
+/** @brief Reproduce una repetición sin throttling y verifica el resultado grabado.
+ *  @details Compara cada keyframe posterior a seek con el estado re-simulado; el primer
+ *           tick distinto señala dónde un cambio de física hizo divergir la partida.
+ *  @param seek tick desde el que empezar (se llega vía keyframes).
+ */
+static int run_replay_fast(const char* path, long seek) {
+    ReplayFile rf;
+    const char* err;
+    if (!replay_open(&rf, path, &err)) {
+        fprintf(stderr, "%s: %s\n", path, err);
+        return 1;
+    }
+    auto start = high_resolution_clock::now();
+    Match m;
+    ReplayCursor c;
+    replay_seek(&rf, &m, &c, seek);
+    const long long from = m.ticks;
+    const ReplayFooter* f = &rf.foot;
+    uint64_t next_key = 0;
+    while (next_key < f->n_keyframes && rf.keys[next_key].tick <= m.ticks) next_key++;
+    long long diverged_at = -1;
+    int d1, d2;
+    while (replay_next_input(&rf, &c, &d1, &d2)) {
+        match_step(&m, d1, d2);
+        if (next_key < f->n_keyframes && rf.keys[next_key].tick == m.ticks) {
+            ReplayKeyframe k;
+            replay_keyframe_from_match(&k, &m, c.off);
+            if (diverged_at < 0 && memcmp(&k, &rf.keys[next_key], sizeof(k)) != 0) diverged_at = m.ticks;
+            next_key++;
+        }
+    }
+    auto end = high_resolution_clock::now();
+    double secs = duration<double>(end - start).count();
+
+    const bool ok = diverged_at < 0 && m.ticks == f->ticks && m.score.p1 == f->final_score.p1 &&
+                    m.score.p2 == f->final_score.p2;
+    printf("--- REPLAY ---\n");
+    printf("%s vs %s (semilla %llu, campo %dx%d)\n", rf.hdr.name1, rf.hdr.name2,
+           (unsigned long long)rf.hdr.seed, rf.hdr.cols, rf.hdr.lines);
+    printf("Entradas: %llu bytes, keyframes: %llu\n",
+           (unsigned long long)f->input_bytes, (unsigned long long)f->n_keyframes);
+    printf("Ticks: %lld (desde %lld)\n", (long long)m.ticks, from);
+    printf("Marcador: %d - %d (grabado %d - %d)\n", m.score.p1, m.score.p2,
+           f->final_score.p1, f->final_score.p2);
+    printf("Tiempo: %.4f s, Ticks/s: %.0f\n", secs, secs > 0 ? (m.ticks - from) / secs : 0.0);
+    if (diverged_at >= 0) printf("Primer keyframe distinto: tick %lld\n", diverged_at);
+    printf("Verificacion: %s\n", ok ? "OK" : "DIVERGE");
+    replay_close(&rf);
+    return ok ? 0 : 2;
+}
+
+/** @brief Visor de repeticiones a tiempo real con el renderer en uso.
+ *  @details Un solo hilo: avanza un tick por deadline (TICK_NSEC_PLAY) sobre g_match.
+ *           Flechas izq/der saltan REPLAY_SEEK_TICKS usando los keyframes.
+ */
+static int replay_view_screen(const char* path, long seek) {
+    ReplayFile rf;
+    const char* err;
+    if (!replay_open(&rf, path, &err)) {
+        endwin();
+        fprintf(stderr, "%s: %s\n", path, err);
+        return 1;
+    }
+    int H, W;
+    getmaxyx(stdscr, H, W);
+    if (rf.hdr.lines > H || rf.hdr.cols > W) {
+        endwin();
+        fprintf(stderr, "%s: necesita una terminal de %dx%d\n", path, rf.hdr.cols, rf.hdr.lines);
+        replay_close(&rf);
+        return 1;
+    }
+    snprintf(g_name1, sizeof(g_name1), "%s", rf.hdr.name1);
+    snprintf(g_name2, sizeof(g_name2), "%s", rf.hdr.name2);
+
+    ReplayCursor c;
+    replay_seek(&rf, &g_match, &c, seek);
+    clear();
+    refresh();
+    create_field_windows(rf.hdr.lines, rf.hdr.cols);
+    if (g_render_backend == RENDER_ANSI &&
+        !ansi_fb_init(&g_fb, STDOUT_FILENO, rf.hdr.lines, rf.hdr.cols)) {
+        ansi_fb_free(&g_fb);
+        g_render_backend = RENDER_CURSES;
+    }
+    nodelay(stdscr, TRUE);
+
+    bool paused = false;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (;;) {
+        int ch;
+        long jump = 0;
+        while ((ch = getch()) != ERR) {
+            if (ch == 'q' || ch == 'Q') goto END_VIEW;
+            if (ch == 'p' || ch == 'P') paused = !paused;
+            if (ch == KEY_RIGHT) jump += REPLAY_SEEK_TICKS;
+            if (ch == KEY_LEFT)  jump -= REPLAY_SEEK_TICKS;
+        }
+        if (jump != 0) {
+            replay_seek(&rf, &g_match, &c, g_match.ticks + jump);
+            g_rs.valid = false;
+        } else if (!paused) {
+            int d1, d2;
+            if (replay_next_input(&rf, &c, &d1, &d2)) match_step(&g_match, d1, d2);
+        }
+
+        WorldSnapshot snap;
+        snapshot_from_match(&snap, &g_match);
+        snap.paused = paused;
+        char status[96];
+        snprintf(status, sizeof(status), "REPLAY %lld/%lld  (<- -> buscar, P pausa, Q salir)",
+                 (long long)g_match.ticks, (long long)rf.foot.ticks);
+        const int status_y = rf.hdr.lines - 1;
+        if (g_render_backend == RENDER_ANSI) {
+            ansi_draw_world(&g_fb, &g_match, &snap);
+            ansi_fb_print(&g_fb, status_y, 2, status, 4, false);
+            ansi_fb_present(&g_fb);
+        } else {
+            render_dirty(g_win_dynamic, &snap);
+            wattron(g_win_dynamic, COLOR_PAIR(4));
+            mvwprintw(g_win_dynamic, status_y, 2, "%s", status);
+            wclrtoeol(g_win_dynamic);
+            wattroff(g_win_dynamic, COLOR_PAIR(4));
+            wnoutrefresh(g_win_dynamic);
+            doupdate();
+        }
+
+        timespec_add_ns(&next, TICK_NSEC_PLAY);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+END_VIEW:
+    replay_close(&rf);
+    return 0;
+}
+
+/** @brief Importa un CSV de puntajes al leaderboard binario y a las estadísticas por
+ *         jugador (reemplaza el contenido de ambos).
+ */
+static int run_import_csv(const char* path) {
+    int jfd = lb_lock_journal();
+    if (jfd < 0) {
+        fprintf(stderr, "No se pudo abrir %s\n", LEADERBOARD_JNL);
+        return 1;
+    }
+    // Leaderboard y estadísticas por jugador salen del mismo CSV bajo el mismo lock.
+    long n = lb_import_csv_locked(jfd, path);
+    if (n >= 0 && !players_rebuild_locked(path)) n = -1;
+    lb_unlock_journal(jfd);
+    if (n < 0) {
+        fprintf(stderr, "No se pudo importar %s\n", path);
+        return 1;
+    }
+    printf("Importadas %ld partidas de %s a %s y %s\n", n, path, LEADERBOARD_SNAP, LEADERBOARD_PLAYERS);
+    return 0;
+}
+
+/** @brief Muestra las opciones de línea de comandos. */
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s [--headless [--matches N] [--batch L [--batch-isa I]]] [--seed S] [--render curses|ansi] [--render-bench N] [--import-csv F]\n", prog);
+    fprintf(stderr, "       %s [--record F] [--trace F] | --replay F [--fast] [--seek T]\n", prog);
+    fprintf(stderr, "       %s --tournament rr|swiss [--games N] [--rounds R] [--threads T] [--tournament-out F]\n", prog);
+    fprintf(stderr, "       %s --calibrate [--threads T] [--calibrate-out F]\n", prog);
+    fprintf(stderr, "  --headless        simula partidas CVC sin terminal ni sleeps\n");
+    fprintf(stderr, "  --matches N       cantidad de partidas headless (default 1)\n");
+    fprintf(stderr, "  --batch L         con --headless: lotes SoA vectoriales de L partidas simultáneas por hilo\n");
+    fprintf(stderr, "  --batch-isa I     con --batch: kernel scalar, sse4.1 o avx2 (default: el mejor de la CPU)\n");
+    fprintf(stderr, "  --seed S          semilla base de las partidas (default: hora actual)\n");
+    fprintf(stderr, "  --difficulty D    nivel de la CPU:");
+    for (const CpuConfig& c : DIFFICULTY_PRESETS) fprintf(stderr, " %s", c.name);
+    fprintf(stderr, " (default: CPU clásica)\n");
+    fprintf(stderr, "  --render B        backend de dibujo en juego: curses (default) o ansi\n");
+    fprintf(stderr, "  --render-bench N  renderiza N frames CVC con el backend ANSI a stdout\n");
+    fprintf(stderr, "  --import-csv F    importa el CSV F al leaderboard binario y a las estadísticas por jugador, y sale\n");
+    fprintf(stderr, "  --record F        graba cada partida jugada en F (luego F.2, F.3, ...)\n");
+    fprintf(stderr, "  --replay F        reproduce la repeticion F a tiempo real\n");
+    fprintf(stderr, "  --fast            con --replay: sin sleeps ni terminal; verifica el resultado\n");
+    fprintf(stderr, "  --seek T          con --replay: empieza en el tick T\n");
+    fprintf(stderr, "  --trace F         escribe al salir una traza Chrome Trace Event (JSON) en F\n");
+    fprintf(stderr, "  --tournament T    torneo headless de configuraciones de IA: rr (todos contra todos) o swiss\n");
+    fprintf(stderr, "  --games N         con --tournament: partidas por serie (default 10)\n");
+    fprintf(stderr, "  --rounds R        con --tournament swiss: rondas (default log2(configs) + 2)\n");
+    fprintf(stderr, "  --threads T       con --tournament, --calibrate o --batch: hilos del pool (default: todos los núcleos)\n");
+    fprintf(stderr, "  --tournament-out F  con --tournament: una fila por partida, formato de " LEADERBOARD_FILE " (default " TOURNEY_OUT ")\n");
+    fprintf(stderr, "  --calibrate       busca CpuConfig para cada nivel de dificultad y emite DIFFICULTY_PRESETS\n");
+    fprintf(stderr, "  --calibrate-out F con --calibrate: escribe la tabla en F (default stdout)\n");
+}
+
+#ifndef PONG_NO_MAIN
 /** @brief Punto de entrada: init ncurses, bucle de escenas y reporte de tiempos. */
-int main(void) {
-    srand((unsigned int)time(NULL));
+int main(int argc, char** argv) {
+    bool headless = false;
+    long n_matches = 1;
+    int batch_lanes = 0;
+    const char* batch_isa = NULL;
+    long bench_frames = 0;
+    const char* import_path = NULL;
+    bool seed_given = false;
+    const char* replay_path = NULL;
+    bool replay_fast = false;
+    long replay_seek_tick = 0;
+    bool tournament = false;
+    TourneyFormat tourney_format = TOURNEY_ROUND_ROBIN;
+    int tourney_games = 10, tourney_rounds = 0, tourney_threads = 0;
+    const char* tourney_out = TOURNEY_OUT;
+    bool calibrate = false;
+    const char* calibrate_out = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--matches") == 0 && i + 1 < argc) {
+            n_matches = strtol(argv[++i], NULL, 10);
+            if (n_matches < 1) n_matches = 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_lanes = (int)strtol(argv[++i], NULL, 10);
+            if (batch_lanes < 1) batch_lanes = BATCH_LANES_DEFAULT;
+        } else if (strcmp(argv[i], "--batch-isa") == 0 && i + 1 < argc) {
+            batch_isa = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            g_seed = strtoull(argv[++i], NULL, 10);
+            seed_given = true;
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            const char* b = argv[++i];
+            if (strcmp(b, "ansi") == 0) g_render_backend = RENDER_ANSI;
+            else if (strcmp(b, "curses") == 0) g_render_backend = RENDER_CURSES;
+            else { print_usage(argv[0]); return 1; }
+        } else if (strcmp(argv[i], "--import-csv") == 0 && i + 1 < argc) {
+            import_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            g_record_path = argv[++i];
+        } else if (strcmp(argv[i], "--tournament") == 0 && i + 1 < argc) {
+            const char* f = argv[++i];
+            if (strcmp(f, "rr") == 0) tourney_format = TOURNEY_ROUND_ROBIN;
+            else if (strcmp(f, "swiss") == 0) tourney_format = TOURNEY_SWISS;
+            else { print_usage(argv[0]); return 1; }
+            tournament = true;
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            tourney_games = (int)strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            tourney_rounds = (int)strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            tourney_threads = (int)strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--tournament-out") == 0 && i + 1 < argc) {
+            tourney_out = argv[++i];
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            const char* d = argv[++i];
+            g_cpu_config = NULL;
+            for (const CpuConfig& c : DIFFICULTY_PRESETS) {
+                if (strcmp(c.name, d) == 0) g_cpu_config = &c;
+            }
+            if (!g_cpu_config) { print_usage(argv[0]); return 1; }
+        } else if (strcmp(argv[i], "--calibrate") == 0) {
+            calibrate = true;
+        } else if (strcmp(argv[i], "--calibrate-out") == 0 && i + 1 < argc) {
+            calibrate_out = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            g_trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            replay_fast = true;
+        } else if (strcmp(argv[i], "--seek") == 0 && i + 1 < argc) {
+            replay_seek_tick = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--render-bench") == 0 && i + 1 < argc) {
+            bench_frames = strtol(argv[++i], NULL, 10);
+            if (bench_frames < 1) bench_frames = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // --batch solo existe en modo headless y --batch-isa solo con --batch.
+    if ((batch_lanes > 0 && !headless) || (batch_isa && batch_lanes == 0)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!seed_given) g_seed = (uint64_t)time(NULL);
+    if (import_path) return run_import_csv(import_path);
+    if (headless && batch_lanes > 0) return run_headless_batch(n_matches, batch_lanes, tourney_threads, batch_isa);
+    if (headless) return run_headless(n_matches);
+    if (calibrate) return run_calibration(tourney_threads, calibrate_out);
+    if (tournament) return run_tournament(tourney_format, tourney_games, tourney_rounds, tourney_threads, tourney_out);
+    if (bench_frames > 0) return run_render_bench(bench_frames);
+    if (replay_path && replay_fast) return run_replay_fast(replay_path, replay_seek_tick);
+    if (g_trace_path && !trace_start()) {
+        fprintf(stderr, "Sin memoria para los anillos de --trace\n");
+        return 1;
+    }
+
     initscr();
 
     if (has_colors()) {
@@ -993,9 +4836,21 @@ int main(void) {
     noecho();
     keypad(stdscr, TRUE);
     curs_set(0);
+    if (replay_path) {
+        int rc = replay_view_screen(replay_path, replay_seek_tick);
+        if (g_win_dynamic) delwin(g_win_dynamic);
+        if (g_win_static)  delwin(g_win_static);
+        if (!isendwin()) endwin();
+        ansi_fb_free(&g_fb);
+        if (g_trace_path && !trace_write(g_trace_path)) fprintf(stderr, "No se pudo escribir %s\n", g_trace_path);
+        return rc;
+    }
+    lb_writer_start();
 
     Scene scene = SC_MENU;
     while (!g_exit_requested) {
+        const Scene scene_cur = scene;
+        const int64_t t_scene = mono_ns();
         if (scene == SC_MENU) {
             auto start = std::chrono::high_resolution_clock::now();
             int sel = menu_screen();   // << medir menú
@@ -1070,34 +4925,81 @@ int main(void) {
             time_leaderboard += (e - s);
             scene = SC_MENU;
         }
+        trace_span(&g_tr_main, SCENE_TRACE_NAME[scene_cur], t_scene, mono_ns());
     }
     if (g_win_dynamic) delwin(g_win_dynamic);
     if (g_win_static)  delwin(g_win_static);
+    ansi_fb_free(&g_fb);
+    lb_writer_stop();   // vacía la cola pendiente antes de salir
+    if (g_trace_path && !trace_write(g_trace_path)) fprintf(stderr, "No se pudo escribir %s\n", g_trace_path);
 
     endwin();
         // ---- PERFIL FINAL ----
-    double total = time_ball.count() + time_p1.count() + time_p2.count() + 
+    const double t_ball   = hist_seconds(&g_prof_sim.ball);
+    const double t_p1     = hist_seconds(&g_prof_sim.p1);
+    const double t_p2     = hist_seconds(&g_prof_sim.p2);
+    const double t_render = hist_seconds(&g_hist_render);
+    double total = t_ball + t_p1 + t_p2 + 
                    time_menu.count() + time_instructions.count() +
-                   time_leaderboard.count() + time_render.count();
+                   time_leaderboard.count() + t_render;
 
     printf("\n--- PERFIL DE TIEMPOS ---\n");
-    printf("Bola: %.4f s (%.1f%%)\n", time_ball.count(), 100 * time_ball.count() / total);
-    printf("Paleta 1: %.4f s (%.1f%%)\n", time_p1.count(), 100 * time_p1.count() / total);
-    printf("Paleta 2: %.4f s (%.1f%%)\n", time_p2.count(), 100 * time_p2.count() / total);
+    printf("Bola: %.4f s (%.1f%%)\n", t_ball, 100 * t_ball / total);
+    printf("Paleta 1: %.4f s (%.1f%%)\n", t_p1, 100 * t_p1 / total);
+    printf("Paleta 2: %.4f s (%.1f%%)\n", t_p2, 100 * t_p2 / total);
     printf("Menu: %.4f s (%.1f%%)\n", time_menu.count(), 100 * time_menu.count() / total);
     printf("Instrucciones: %.4f s (%.1f%%)\n", time_instructions.count(), 100 * time_instructions.count() / total);
     printf("Leaderboard: %.4f s (%.1f%%)\n", time_leaderboard.count(), 100 * time_leaderboard.count() / total);
-    printf("Renderizado: %.4f s (%.1f%%)\n", time_render.count(), 100 * time_render.count() / total);
+    printf("Renderizado: %.4f s (%.1f%%)\n", t_render, 100 * t_render / total);
     printf("Tiempo total medido: %.4f s\n", total);
 
-    double T_seq = time_menu.count() + time_instructions.count() + time_leaderboard.count() + time_render.count();
-    double T_par = time_ball.count() + time_p1.count() + time_p2.count();
-    double f_seq = T_seq / total;
-    double f_par = T_par / total;
+    printf("\n--- DISTRIBUCION POR TICK / FRAME (us) ---\n");
+    printf("%-17s %9s %10s %10s %10s %10s\n", "", "n", "min", "p50", "p99", "max");
+    hist_print_row("Paleta 1 (tick)", &g_prof_sim.p1);
+    hist_print_row("Paleta 2 (tick)", &g_prof_sim.p2);
+    hist_print_row("Bola (tick)",     &g_prof_sim.ball);
+    hist_print_row("Render (frame)",  &g_hist_render);
+    printf("\n");
+
+    double sim_wall = time_sim_wall.count();
+    printf("Ticks simulacion: %lld (%.1f ticks/s, objetivo %d)\n", g_sim_ticks,
+           sim_wall > 0 ? g_sim_ticks / sim_wall : 0.0, TARGET_FPS_PLAY);
+    printf("Ticks tarde: %lld, descartados: %lld\n", g_sim_late, g_sim_dropped);
+    if (g_input_dropped > 0) printf("Eventos de entrada descartados (cola llena): %lld\n", g_input_dropped);
+    if (g_fb.frames > 0) {
+        printf("Backend ANSI: %lld frames, %.1f bytes/frame, %.2f write()/frame\n", g_fb.frames,
+               (double)g_fb.bytes / g_fb.frames, (double)g_fb.writes / g_fb.frames);
+    }
+
+    // Amdahl sobre CPU real: el hilo principal (menús, render, E/S de terminal) es la
+    // parte secuencial; los hilos secundarios corren en paralelo con él. La espera por
+    // g_lock es tiempo bloqueado y no cuenta como trabajo de nadie.
+    g_ts_main.cpu_ns = thread_cpu_ns();
+    struct { const char* name; const ThreadStats* ts; } threads[] = {
+        { "principal",   &g_ts_main },
+        { "simulacion",  &g_ts_sim },
+        { "entrada",     &g_ts_input },
+        { "leaderboard", &g_ts_lb },
+    };
+    printf("\n--- HILOS: CPU Y g_lock (s) ---\n");
+    printf("%-12s %10s %12s %12s %10s\n", "", "CPU", "espera lock", "con lock", "adquis.");
+    for (auto& t : threads) {
+        printf("%-12s %10.4f %12.4f %12.4f %10lld\n", t.name, t.ts->cpu_ns / 1e9,
+               t.ts->lock_wait_ns / 1e9, t.ts->lock_hold_ns / 1e9, t.ts->lock_count);
+    }
+    printf("\n");
+
+    double T_seq = g_ts_main.cpu_ns / 1e9;
+    double T_par = (g_ts_sim.cpu_ns + g_ts_input.cpu_ns + g_ts_lb.cpu_ns) / 1e9;
+    double f_seq = (T_seq + T_par) > 0 ? T_seq / (T_seq + T_par) : 0.0;
+    double f_par = (T_seq + T_par) > 0 ? T_par / (T_seq + T_par) : 0.0;
 
     printf("T_seq: %.4f s\n", T_seq);
     printf("T_par: %.4f s\n", T_par);
     printf("f_seq: %.4f\n", f_seq);
     printf("f_par: %.4f\n", f_par);
+    printf("Speedup max (Amdahl): %.2fx\n", f_seq > 0 ? 1.0 / f_seq : 0.0);
+    latency_report();
     return 0;
 }
+#endif // PONG_NO_MAIN